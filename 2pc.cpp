@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "2pc.h"
+#include "bench/percentile.h"
+#include "engines/procedures.h"
+
+using std::cout;
+using std::endl;
+using bench::percentile;
+
+namespace twopc {
+
+Request mock_tx(std::mt19937& gen) {
+  std::uniform_int_distribution<int> dis(1, Experiment::n_slots - 1);
+  Request req{engines::increment<Txn>, {}, 3, nullptr};
+  for (int i = 0; i < 3; i++) {
+    req.slots_[i] = dis(gen);
+  }
+  return req;
+}
+
+void run() {
+  using clk = std::chrono::steady_clock;
+  std::random_device rd;
+  std::mt19937 gen(rd());
+
+  int cores = Experiment::cores;
+  std::vector<std::vector<Request>> txs(cores);
+  for (auto& part : txs) {
+    part.reserve(Experiment::tx_count / cores);
+    for (int j = 0; j < Experiment::tx_count / cores; j++) {
+      part.push_back(mock_tx(gen));
+    }
+  }
+  Engine engine(std::vector<int>(Experiment::n_slots, 1));
+
+  // Latency of every transaction, from its first attempt to its commit, in us
+  std::vector<std::vector<double>> latencies(cores);
+  auto worker = [&engine, &txs, &latencies](int id) {
+    latencies[id].reserve(txs[id].size());
+    for (const auto& req : txs[id]) {
+      auto start = clk::now();
+      engine.execute(req);
+      latencies[id].push_back(std::chrono::duration<double, std::micro>(clk::now() - start).count());
+    }
+  };
+
+  auto start = clk::now();
+  std::vector<std::thread> ts;
+  for (int id = 0; id < cores; id++) {
+    ts.emplace_back(worker, id);
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  double secs = std::chrono::duration<double>(clk::now() - start).count();
+
+  std::vector<double> all;
+  for (auto& l : latencies) {
+    all.insert(all.end(), l.begin(), l.end());
+  }
+  std::sort(all.begin(), all.end());
+  auto stats = engine.stats();
+  cout << "2pl: " << stats.commits_ << " transactions in " << secs << " s, " << stats.commits_ / secs << " tx/s, "
+       << stats.aborts_ << " aborts, " << stats.waits_ << " lock waits" << endl;
+  cout << "latency: p50 " << percentile(all, 0.5) << " us, p99 " << percentile(all, 0.99) << " us, p99.9 "
+       << percentile(all, 0.999) << " us" << endl;
+  cout << "checksum at the end: " << engine.checksum() << endl;
+}
+
+} // namespace twopc
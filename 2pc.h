@@ -0,0 +1,16 @@
+#pragma once
+
+#include "engines/2pc/2pc_engine.h"
+
+namespace twopc {
+
+  // The experiment of lazy::run, on the two-phase locking engine
+  struct Experiment {
+    static constexpr int n_slots = 100000;
+    static constexpr int tx_count = 400000;
+    static constexpr int cores = 4;
+  };
+
+  void run();
+
+} // namespace twopc
@@ -0,0 +1,274 @@
+// Runs the same workload against every engine behind engines::Engine, and
+// prints one JSON object per engine, so that configurations can be compared
+// side by side. Engines with "durable": true only acknowledge a batch once
+// it is on disk, so their latencies include a log sync.
+//
+// The workload is the one of lazy::run: transactions which increment 3
+// random slots, submitted in batches by several client threads, then
+// client reads of random slots, then a scan of the whole table (whose sum
+// checks that every transaction was applied exactly once).
+//
+//   bench_engines [--engines=lazy,2pl,eager] [--slots=N] [--txs=N]
+//                 [--cores=N] [--clients=N] [--batch=N] [--reads=N] [--local]
+//
+// --local keeps every transaction within one of the regions the eager
+// engine partitions the slots into (one per core).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../engines/2pc/adapter.h"
+#include "../engines/eager/adapter.h"
+#include "../engines/engine.h"
+#include "../engines/lazy/adapter.h"
+#include "../engines/lazy/lazy_engine.h"
+#include "percentile.h"
+
+using std::cout;
+using std::endl;
+using bench::percentile;
+
+using clk = std::chrono::steady_clock;
+
+struct Config {
+  std::string engines = "lazy,2pl,eager";
+  int slots = lazy::Globals::n_slots;
+  int txs = lazy::Globals::tx_count;
+  int cores = lazy::Globals::subst_cores;
+  int clients = 4;
+  int batch = 1024;
+  int reads = 400000;
+  bool local = false;
+};
+
+// Engines the driver knows about, by name
+struct Factory {
+  const char* name_;
+  std::function<std::unique_ptr<engines::Engine>(const Config&)> make_;
+};
+
+const std::vector<Factory>& factories() {
+  static const std::vector<Factory> all{
+    {"lazy", [](const Config& c) { return std::make_unique<lazy::Adapter>(c.slots, c.cores); }},
+    {"2pl", [](const Config& c) { return std::make_unique<twopc::Adapter>(c.slots); }},
+    {"eager", [](const Config& c) { return std::make_unique<eager::Adapter>(c.slots, c.cores); }},
+  };
+  return all;
+}
+
+// Resident and peak resident memory of the process, from /proc (0 elsewhere)
+struct Memory {
+  long rss_;
+  long peak_;
+
+  static Memory now() {
+    Memory m{0, 0};
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+      std::istringstream in(line);
+      std::string key;
+      long kb = 0;
+      in >> key >> kb;
+      if (key == "VmRSS:") {
+        m.rss_ = kb * 1024;
+      } else if (key == "VmHWM:") {
+        m.peak_ = kb * 1024;
+      }
+    }
+    return m;
+  }
+};
+
+struct Percentiles {
+  double p50_;
+  double p99_;
+  double p999_;
+
+  static Percentiles of(std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+    return Percentiles{percentile(samples, 0.5), percentile(samples, 0.99), percentile(samples, 0.999)};
+  }
+};
+
+std::ostream& operator<<(std::ostream& out, const Percentiles& p) {
+  return out << "{\"p50\": " << p.p50_ << ", \"p99\": " << p.p99_ << ", \"p999\": " << p.p999_ << "}";
+}
+
+// The transactions of every client
+std::vector<std::vector<engines::Tx>> workload(const Config& c, std::mt19937& gen) {
+  // Regions of the eager engine
+  int span = (c.slots + c.cores - 1) / c.cores;
+  std::uniform_int_distribution<int> region(0, c.cores - 1);
+  std::vector<std::vector<engines::Tx>> txs(c.clients);
+  for (int i = 0; i < c.txs; i++) {
+    int lo = 1;
+    int hi = c.slots - 1;
+    if (c.local) {
+      int r = region(gen);
+      lo = std::max(1, r * span);
+      hi = std::min(hi, (r + 1) * span - 1);
+    }
+    std::uniform_int_distribution<int> dis(lo, hi);
+    engines::Tx tx{engines::TxType::INCREMENT, {}, 3};
+    for (int j = 0; j < 3; j++) {
+      tx.slots_[j] = dis(gen);
+    }
+    txs[i % c.clients].push_back(tx);
+  }
+  return txs;
+}
+
+// Runs fn(id) on every client, returns the wall time in seconds
+template<typename Fn>
+double on_clients(int clients, Fn&& fn) {
+  auto start = clk::now();
+  std::vector<std::thread> ts;
+  for (int id = 0; id < clients; id++) {
+    ts.emplace_back(fn, id);
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  return std::chrono::duration<double>(clk::now() - start).count();
+}
+
+double us_since(clk::time_point start) {
+  return std::chrono::duration<double, std::micro>(clk::now() - start).count();
+}
+
+void run(const Factory& factory, const Config& c, const std::vector<std::vector<engines::Tx>>& txs) {
+  Memory before = Memory::now();
+  auto engine = factory.make_(c);
+
+  // A transaction waits for its whole batch to commit
+  std::vector<std::vector<double>> tx_latencies(c.clients);
+  double write_secs = on_clients(c.clients, [&](int id) {
+    const auto& mine = txs[id];
+    for (std::size_t i = 0; i < mine.size(); i += c.batch) {
+      int n = std::min<std::size_t>(c.batch, mine.size() - i);
+      auto start = clk::now();
+      engine->submit(mine.data() + i, n);
+      tx_latencies[id].insert(tx_latencies[id].end(), n, us_since(start));
+    }
+  });
+
+  // Clients read this many slots per call, like the ones of lazy::run
+  constexpr int READ_BATCH = 256;
+  std::vector<std::vector<double>> read_latencies(c.clients);
+  double read_secs = on_clients(c.clients, [&](int id) {
+    std::mt19937 gen(id);
+    std::uniform_int_distribution<int> dis(0, c.slots - 1);
+    std::vector<int> slots(READ_BATCH);
+    std::vector<int> vals(READ_BATCH);
+    for (int i = 0; i < c.reads / c.clients; i += READ_BATCH) {
+      for (auto& s : slots) {
+        s = dis(gen);
+      }
+      auto start = clk::now();
+      engine->read(slots.data(), READ_BATCH, vals.data());
+      read_latencies[id].push_back(us_since(start));
+    }
+  });
+
+  std::vector<int> table(c.slots);
+  auto start = clk::now();
+  engine->scan(0, c.slots, table.data());
+  double scan_ms = us_since(start) / 1000;
+  int64_t checksum = 0;
+  for (int v : table) {
+    checksum += v;
+  }
+
+  Memory after = Memory::now();
+  engine->shutdown();
+
+  std::vector<double> all_tx;
+  std::vector<double> all_reads;
+  for (int id = 0; id < c.clients; id++) {
+    all_tx.insert(all_tx.end(), tx_latencies[id].begin(), tx_latencies[id].end());
+    all_reads.insert(all_reads.end(), read_latencies[id].begin(), read_latencies[id].end());
+  }
+  long n_txs = all_tx.size();
+  long n_reads = all_reads.size() * READ_BATCH;
+  cout << "{\"engine\": \"" << factory.name_ << "\", \"durable\": " << (engine->durable() ? "true" : "false")
+       << ", \"slots\": " << c.slots << ", \"txs\": " << n_txs
+       << ", \"cores\": " << c.cores << ", \"clients\": " << c.clients << ", \"batch\": " << c.batch
+       << ", \"local\": " << (c.local ? "true" : "false")
+       << ", \"tx_per_s\": " << n_txs / write_secs << ", \"tx_latency_us\": " << Percentiles::of(all_tx)
+       << ", \"reads\": " << n_reads << ", \"reads_per_s\": " << n_reads / read_secs
+       << ", \"read_batch_latency_us\": " << Percentiles::of(all_reads) << ", \"scan_ms\": " << scan_ms
+       << ", \"rss_delta_bytes\": " << after.rss_ - before.rss_ << ", \"rss_peak_bytes\": " << after.peak_
+       << ", \"checksum\": " << checksum << ", \"expected_checksum\": " << c.slots + 3L * n_txs << "}" << endl;
+}
+
+Config parse(int argc, char** argv) {
+  Config c;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&arg](const char* flag) -> const char* {
+      std::size_t n = std::char_traits<char>::length(flag);
+      return arg.compare(0, n, flag) == 0 ? arg.c_str() + n : nullptr;
+    };
+    if (const char* v = value("--engines=")) {
+      c.engines = v;
+    } else if (const char* v = value("--slots=")) {
+      c.slots = std::stoi(v);
+    } else if (const char* v = value("--txs=")) {
+      c.txs = std::stoi(v);
+    } else if (const char* v = value("--cores=")) {
+      c.cores = std::stoi(v);
+    } else if (const char* v = value("--clients=")) {
+      c.clients = std::stoi(v);
+    } else if (const char* v = value("--batch=")) {
+      c.batch = std::stoi(v);
+    } else if (const char* v = value("--reads=")) {
+      c.reads = std::stoi(v);
+    } else if (arg == "--local") {
+      c.local = true;
+    } else {
+      throw std::invalid_argument("Unknown argument " + arg);
+    }
+  }
+  if (c.slots < 2 || c.cores < 1 || c.clients < 1 || c.batch < 1 || c.txs < 0 || c.reads < 0) {
+    throw std::invalid_argument("Invalid configuration");
+  }
+  return c;
+}
+
+int main(int argc, char** argv) {
+  Config c;
+  try {
+    c = parse(argc, argv);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << endl;
+    return 1;
+  }
+
+  std::mt19937 gen(42);
+  auto txs = workload(c, gen);
+
+  std::istringstream names(c.engines);
+  std::string name;
+  while (std::getline(names, name, ',')) {
+    auto it = std::find_if(factories().begin(), factories().end(),
+                           [&name](const Factory& f) { return name == f.name_; });
+    if (it == factories().end()) {
+      std::cerr << "unknown engine " << name << endl;
+      return 1;
+    }
+    run(*it, c, txs);
+  }
+  return 0;
+}
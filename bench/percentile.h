@@ -0,0 +1,18 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace bench {
+
+  // The p-quantile (p in [0, 1]) of samples sorted in increasing order,
+  // 0 if there are none
+  inline double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+      return 0;
+    }
+    return sorted[std::min<std::size_t>(sorted.size() - 1, p * sorted.size())];
+  }
+
+} // namespace bench
@@ -0,0 +1,224 @@
+// Compares the inline/overflow version store of LinkedIntColumn against the
+// singly linked list of heap-allocated nodes that it used to be built on.
+//
+// The workload mimics the stickification/substantiation/read cycle of the lazy
+// engine on a skewed key distribution: stickies are appended to slots chosen
+// by a zipfian distribution, every sticky is then substantiated in place and
+// finally the versions are read back in random order, followed by a
+// latest_value() pass over every slot (what LinkedTable::checksum() does).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../engines/lazy/linked_table.h"
+
+using std::cout;
+using std::endl;
+
+namespace legacy {
+
+  using lazy::Entry;
+  using lazy::Time;
+
+  // The version store as it was before the inline version arrays
+  struct ListBucket {
+    struct BucketNode {
+      Entry entry_;
+      std::atomic<BucketNode*> next_;
+      BucketNode(Time t, int val): entry_(t, val), next_(nullptr) {}
+    };
+
+    ListBucket(Time t, int val) {
+      auto* node = new BucketNode(t, val);
+      head_ = node;
+      tail_ = node;
+    }
+    ListBucket(ListBucket&& other) {
+      head_.store(other.head_.load());
+      tail_.store(other.tail_.load());
+      other.head_.store(nullptr);
+      other.tail_.store(nullptr);
+    }
+
+    std::atomic<BucketNode*> head_;
+    std::atomic<BucketNode*> tail_;
+
+    void push(Time t, int val) {
+      auto* e = new BucketNode(t, val);
+      auto prev_tail = tail_.load(std::memory_order_seq_cst);
+      while (!tail_.compare_exchange_strong(prev_tail, e, std::memory_order_seq_cst, std::memory_order_seq_cst)) {
+        prev_tail = tail_.load(std::memory_order_seq_cst);
+      }
+      prev_tail->next_.store(e, std::memory_order_seq_cst);
+    }
+
+    std::optional<Entry::EntryData> entry_at(Time t) {
+      for (auto* e = head_.load(); e != nullptr; e = e->next_.load()) {
+        auto entry = e->entry_.load();
+        if (entry.has_time(t)) {
+          return {entry};
+        }
+      }
+      return std::nullopt;
+    }
+
+    void write_at(Time t, int val) {
+      for (auto* e = head_.load(); e != nullptr; e = e->next_.load()) {
+        if (e->entry_.load().has_time(t)) {
+          e->entry_.write(t, val);
+          return;
+        }
+      }
+    }
+
+    int latest_value() {
+      Time latest = 0;
+      int val = 1;
+      for (auto* e = head_.load(); e != nullptr; e = e->next_.load()) {
+        auto entry = e->entry_.load();
+        if (entry.t_ > latest) {
+          latest = entry.t_;
+          val = entry.val_;
+        }
+      }
+      return val;
+    }
+
+    ~ListBucket() {
+      auto* e = head_.load();
+      while (e) {
+        auto* next = e->next_.load();
+        delete e;
+        e = next;
+      }
+    }
+  };
+
+  struct ListColumn {
+    ListColumn(int n) {
+      data_.reserve(n);
+      for (int i = 0; i < n; i++) {
+        data_.emplace_back(ListBucket(lazy::constants::T0, 1));
+      }
+    }
+    void insert_at(int slot, Time t, int val) {
+      data_[slot].push(t, val);
+    }
+    ListBucket& bucket(int slot) {
+      return data_[slot];
+    }
+    int latest_value(int slot) {
+      return data_[slot].latest_value();
+    }
+    std::vector<ListBucket> data_;
+  };
+
+} // namespace legacy
+
+struct ArrayColumn {
+  ArrayColumn(int n): col_(std::vector<int>(n, 1)) {}
+  void insert_at(int slot, lazy::Time t, int val) {
+    col_.insert_at(slot, t, val);
+  }
+  lazy::Bucket& bucket(int slot) {
+    return col_.data_[slot];
+  }
+  int latest_value(int slot) {
+    return col_.latest_value(slot);
+  }
+  lazy::LinkedIntColumn col_;
+};
+
+namespace {
+
+  constexpr int n_slots = 100000;
+  constexpr int n_versions = 500000;
+  constexpr double zipf_theta = 0.8;
+
+  // Slots in the order in which stickies are appended to them
+  std::vector<int> zipf_slots(std::mt19937& gen) {
+    std::vector<double> cdf(n_slots);
+    double sum = 0;
+    for (int i = 0; i < n_slots; i++) {
+      sum += 1.0 / std::pow(i + 1, zipf_theta);
+      cdf[i] = sum;
+    }
+    std::uniform_real_distribution<double> dis(0, sum);
+    std::vector<int> slots(n_versions);
+    for (auto& s : slots) {
+      s = std::lower_bound(cdf.begin(), cdf.end(), dis(gen)) - cdf.begin();
+    }
+    return slots;
+  }
+
+  double ns_per_op(std::chrono::steady_clock::time_point start, long ops) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+  }
+
+  template<typename Column>
+  void run(const char* name, const std::vector<int>& slots, const std::vector<int>& read_order) {
+    using clk = std::chrono::steady_clock;
+
+    auto start = clk::now();
+    Column column(n_slots);
+    double load = ns_per_op(start, n_slots);
+
+    start = clk::now();
+    for (int i = 0; i < n_versions; i++) {
+      lazy::Time t = lazy::constants::T0 + 1 + i;
+      column.insert_at(slots[i], -t, i);
+    }
+    double push = ns_per_op(start, n_versions);
+
+    start = clk::now();
+    for (int i = 0; i < n_versions; i++) {
+      lazy::Time t = lazy::constants::T0 + 1 + i;
+      column.bucket(slots[i]).write_at(t, 1);
+    }
+    double write = ns_per_op(start, n_versions);
+
+    long sink = 0;
+    start = clk::now();
+    for (int i : read_order) {
+      lazy::Time t = lazy::constants::T0 + 1 + i;
+      sink += column.bucket(slots[i]).entry_at(t)->val_;
+    }
+    double read = ns_per_op(start, read_order.size());
+
+    start = clk::now();
+    for (int i = 0; i < n_slots; i++) {
+      sink += column.latest_value(i);
+    }
+    double latest = ns_per_op(start, n_slots);
+
+    cout << name << ": load " << load << " ns/slot, push " << push
+         << " ns/op, write_at " << write << " ns/op, entry_at " << read
+         << " ns/op, latest_value " << latest << " ns/slot (sink " << sink << ")" << endl;
+  }
+
+} // namespace
+
+int main() {
+  std::mt19937 gen(42);
+  auto slots = zipf_slots(gen);
+  std::vector<int> read_order(n_versions);
+  for (int i = 0; i < n_versions; i++) {
+    read_order[i] = i;
+  }
+  std::shuffle(read_order.begin(), read_order.end(), gen);
+
+  cout << n_slots << " slots, " << n_versions << " zipfian(" << zipf_theta << ") versions" << endl;
+  // The version array runs first, so that it does not pay for the heap
+  // the linked list leaves behind
+  run<ArrayColumn>("version array", slots, read_order);
+  run<legacy::ListColumn>("linked list  ", slots, read_order);
+  return 0;
+}
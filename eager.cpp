@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "eager.h"
+#include "bench/percentile.h"
+#include "engines/procedures.h"
+
+using std::cout;
+using std::endl;
+using bench::percentile;
+
+namespace eager {
+
+Request mock_tx(const Engine& engine, std::mt19937& gen, bool local) {
+  int lo = 1;
+  int hi = Experiment::n_slots - 1;
+  if (local) {
+    int p = std::uniform_int_distribution<int>(0, engine.partitions() - 1)(gen);
+    lo = std::max(1, engine.first_slot(p));
+    hi = std::min(hi, engine.first_slot(p + 1) - 1);
+  }
+  std::uniform_int_distribution<int> dis(lo, hi);
+  Request req{engines::increment<Txn>, {}, 3, nullptr};
+  for (int i = 0; i < 3; i++) {
+    req.slots_[i] = dis(gen);
+  }
+  return req;
+}
+
+void run(bool local) {
+  using clk = std::chrono::steady_clock;
+  std::random_device rd;
+  std::mt19937 gen(rd());
+
+  Engine engine(std::vector<int>(Experiment::n_slots, 1), Experiment::cores);
+  std::vector<Request> txs;
+  txs.reserve(Experiment::tx_count);
+  for (int i = 0; i < Experiment::tx_count; i++) {
+    txs.push_back(mock_tx(engine, gen, local));
+  }
+  std::vector<Completion> done(txs.size());
+  std::vector<clk::time_point> submitted(txs.size());
+
+  // Open loop: every client submits its share as fast as the mailboxes
+  // take it
+  auto client = [&engine, &txs, &done, &submitted](int id) {
+    for (std::size_t i = id; i < txs.size(); i += Experiment::clients) {
+      submitted[i] = clk::now();
+      engine.submit(&txs[i], &done[i]);
+    }
+  };
+
+  engine.start();
+  auto start = clk::now();
+  std::vector<std::thread> ts;
+  for (int id = 0; id < Experiment::clients; id++) {
+    ts.emplace_back(client, id);
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  for (const auto& d : done) {
+    d.wait();
+  }
+  double secs = std::chrono::duration<double>(clk::now() - start).count();
+  engine.stop();
+
+  // From submission to completion, in us
+  std::vector<double> latencies(txs.size());
+  for (std::size_t i = 0; i < txs.size(); i++) {
+    latencies[i] = std::chrono::duration<double, std::micro>(done[i].finished_ - submitted[i]).count();
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto stats = engine.stats();
+  cout << "eager: " << txs.size() << " transactions in " << secs << " s, " << txs.size() / secs << " tx/s, "
+       << stats.single_ << " single-region, " << stats.multi_ << " multi-region, " << stats.messages_
+       << " messages between cores" << endl;
+  cout << "latency: p50 " << percentile(latencies, 0.5) << " us, p99 " << percentile(latencies, 0.99)
+       << " us, p99.9 " << percentile(latencies, 0.999) << " us" << endl;
+  cout << "checksum at the end: " << engine.checksum() << endl;
+}
+
+} // namespace eager
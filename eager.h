@@ -0,0 +1,20 @@
+#pragma once
+
+#include "engines/eager/eager_engine.h"
+
+namespace eager {
+
+  // The experiment of lazy::run, on the partitioned engine
+  struct Experiment {
+    static constexpr int n_slots = 100000;
+    static constexpr int tx_count = 400000;
+    // One region per core
+    static constexpr int cores = 4;
+    static constexpr int clients = 2;
+  };
+
+  // Runs the mock transactions of lazy::run on random slots, or if local,
+  // on random slots of a single region each
+  void run(bool local = false);
+
+} // namespace eager
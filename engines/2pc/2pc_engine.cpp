@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#include "2pc_engine.h"
+#include "../lazy/completion.h"
+
+namespace twopc {
+
+  namespace {
+    void read_slots(Txn& tx, const int* slots, int n, int* out) {
+      for (int i = 0; i < n; i++) {
+        out[i] = tx.read(slots[i]);
+      }
+    }
+  }
+
+  int Txn::read(int slot) {
+    lock(slot);
+    return engine_.values_[slot];
+  }
+
+  void Txn::write(int slot, int val) {
+    lock(slot);
+    bool saved = false;
+    for (int i = 0; i < n_undo_; i++) {
+      saved |= undo_[i].slot_ == slot;
+    }
+    // Only the value from before the transaction is ever restored
+    if (!saved) {
+      undo_[n_undo_++] = UndoEntry{slot, engine_.values_[slot]};
+    }
+    engine_.values_[slot] = val;
+  }
+
+  void Txn::lock(int slot) {
+    for (int i = 0; i < n_held_; i++) {
+      if (held_[i] == slot) {
+        return;
+      }
+    }
+    if (n_held_ == MAX_SLOTS) {
+      throw std::length_error("Transaction accesses too many slots");
+    }
+    auto& word = engine_.locks_[slot].owner_;
+    uint64_t owner = 0;
+    int spins = 0;
+    bool waited = false;
+    while (!word.compare_exchange_weak(owner, ts_, std::memory_order_acquire, std::memory_order_relaxed)) {
+      if (owner == 0) {
+        continue;
+      }
+      // Wait-die: only older transactions wait
+      if (ts_ > owner) {
+        throw Abort{};
+      }
+      waited = true;
+      if (++spins < Engine::SPINS) {
+        lazy::completion::cpu_relax();
+      } else {
+        std::this_thread::yield();
+      }
+      owner = 0;
+    }
+    waits_ += waited;
+    held_[n_held_++] = slot;
+  }
+
+  void Txn::commit() {
+    for (int i = 0; i < n_held_; i++) {
+      engine_.locks_[held_[i]].owner_.store(0, std::memory_order_release);
+    }
+    n_held_ = 0;
+    n_undo_ = 0;
+  }
+
+  void Txn::abort() {
+    for (int i = n_undo_ - 1; i >= 0; i--) {
+      engine_.values_[undo_[i].slot_] = undo_[i].val_;
+    }
+    n_undo_ = 0;
+    commit();
+  }
+
+  Engine::Engine(std::vector<int>&& data)
+    : values_(std::move(data)), locks_(values_.size()), next_ts_(1) {}
+
+  void Engine::execute(const Request& req) {
+    Txn tx(*this, next_ts_.fetch_add(1, std::memory_order_relaxed));
+    while (true) {
+      try {
+        req.proc_(tx, req.slots_, req.n_slots_, req.out_);
+        tx.commit();
+        break;
+      } catch (const Abort&) {
+        tx.abort();
+        aborts_.add();
+        // Gives the older transaction which killed us the time to finish
+        std::this_thread::yield();
+      }
+    }
+    commits_.add();
+    if (tx.waits_) {
+      waits_.add(tx.waits_);
+    }
+  }
+
+  void Engine::read(const int* slots, int n, int* out) {
+    if (n < 0 || n > Txn::MAX_SLOTS) {
+      throw std::length_error("Transaction accesses too many slots");
+    }
+    Request req{read_slots, {}, n, out};
+    std::copy(slots, slots + n, req.slots_);
+    execute(req);
+  }
+
+  int Engine::value(int slot) const {
+    return values_[slot];
+  }
+
+  int Engine::size() const {
+    return values_.size();
+  }
+
+  int64_t Engine::checksum() const {
+    int64_t sum = 0;
+    for (int v : values_) {
+      sum += v;
+    }
+    return sum;
+  }
+
+  Engine::Stats Engine::stats() const {
+    return Stats{commits_.load(), aborts_.load(), waits_.load()};
+  }
+
+} // namespace twopc
@@ -1,25 +1,129 @@
+#pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "../lazy/stats.h"
 
 /*
   8/10 cores of machine used
-  each of the 8 threads is worker thread 
+  each of the 8 threads is worker thread
 */
 
-/*
-  For 2pc transaction: look at the operations, then, see all the locks that you need
-  to own, then execute the code when you have them
-
-  How it works: 
-  Acquire a lock every time you want access data as part of a transaction. 
-  Before locking, need to check whether you are creating a deadlock. If yes, abort
-  and get state back to previous time, by saving in memory previous state 
-  of the record and reverting if necessary.
-
-  Is there any way of running into a bug where you revert over someone else's write?
-  Clearly not, since you only drop locks at the end of the transaction, which means
-  you own the lock for that record, which means that nobody else could have written to it
-  after yourself
-  
-*/
+namespace twopc {
+
+  class Engine;
+
+  // Thrown out of Txn::read/write when the transaction has to die (see Engine)
+  struct Abort {};
+
+  // A transaction while it runs: it locks the slots as it accesses them
+  // (growing phase) and keeps every lock until it commits or aborts
+  // (shrinking phase, all at once). Every write saves the value it replaces
+  // in the undo log first, so that an abort can put the slot back.
+  //
+  // Reverting never overwrites someone else's write: the transaction still
+  // holds the lock of every slot in its undo log, so nobody else wrote to
+  // them since.
+  class Txn {
+    public:
+      // Distinct slots one transaction can access
+      static constexpr int MAX_SLOTS = 16;
+
+      int read(int slot);
+      void write(int slot, int val);
+
+    private:
+      friend class Engine;
+
+      struct UndoEntry {
+        int slot_;
+        int val_;
+      };
+
+      Txn(Engine& engine, uint64_t ts): engine_(engine), ts_(ts) {}
+
+      void lock(int slot);
+      void commit();
+      void abort();
+
+      Engine& engine_;
+      // Wait-die priority, kept across retries so that a transaction which
+      // keeps dying eventually becomes the oldest one around
+      uint64_t ts_;
+      int held_[MAX_SLOTS];
+      int n_held_ = 0;
+      UndoEntry undo_[MAX_SLOTS];
+      int n_undo_ = 0;
+      // Lock acquisitions which had to wait for an older owner to be done
+      long waits_ = 0;
+  };
+
+  // Stored procedure: the code of a transaction type, run on the n slots
+  // it is given, which puts its results (if any) in out. It must be
+  // deterministic, since it is rerun after an abort
+  using Procedure = void (*)(Txn& tx, const int* slots, int n, int* out);
+
+  struct Request {
+    Procedure proc_;
+    int slots_[Txn::MAX_SLOTS];
+    int n_slots_;
+    // nullptr for transactions without results
+    int* out_;
+  };
+
+  // Strict two-phase locking over a table of int slots.
+  //
+  // Every slot has a lock word holding the timestamp of the transaction which
+  // owns it (0 if free). Every access takes the lock exclusively: the
+  // transactions of the benchmark write every slot they read, so shared locks
+  // would only be upgraded right away.
+  //
+  // Deadlocks are avoided with wait-die: a transaction waits for a lock only
+  // if it is older than the owner, otherwise it dies (aborts, undoes its
+  // writes, releases its locks) and is retried with the same timestamp.
+  // Waits always go from older to younger transactions, so there is never
+  // a cycle of them.
+  class Engine {
+    public:
+      // Spins on a lock word before yielding the core to its owner
+      static constexpr int SPINS = 128;
+
+      struct Stats {
+        long commits_;
+        long aborts_;
+        long waits_;
+      };
+
+      Engine(std::vector<int>&& data);
+      Engine(const Engine& other) = delete;
+
+      // Runs the request until it commits. Thread-safe
+      void execute(const Request& req);
+      // Committed values of up to Txn::MAX_SLOTS slots, read by a
+      // transaction. Thread-safe
+      void read(const int* slots, int n, int* out);
+      // A committed value. Only consistent while no transaction is running
+      int value(int slot) const;
+      int size() const;
+      int64_t checksum() const;
+      Stats stats() const;
+
+    private:
+      friend class Txn;
+
+      struct alignas(8) LockWord {
+        std::atomic<uint64_t> owner_{0};
+      };
+
+      std::vector<int> values_;
+      std::vector<LockWord> locks_;
+      std::atomic<uint64_t> next_ts_;
 
+      lazy::ShardedCounter commits_;
+      lazy::ShardedCounter aborts_;
+      lazy::ShardedCounter waits_;
+  };
 
+} // namespace twopc
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "adapter.h"
+#include "../procedures.h"
+
+namespace twopc {
+
+  namespace {
+    Procedure procedure_of(engines::TxType type) {
+      switch (type) {
+        case engines::TxType::INCREMENT:
+          return engines::increment<Txn>;
+      }
+      throw std::invalid_argument("Unknown transaction type");
+    }
+  }
+
+  Adapter::Adapter(int n_slots): engine_(std::vector<int>(n_slots, 1)) {}
+
+  const char* Adapter::name() const {
+    return "2pl";
+  }
+
+  bool Adapter::durable() const {
+    return false;
+  }
+
+  // The whole batch is checked first, so that an invalid transaction
+  // throws before any of the batch is committed
+  void Adapter::submit(const engines::Tx* txs, int n) {
+    std::vector<Request> reqs(n);
+    for (int i = 0; i < n; i++) {
+      if (txs[i].n_slots_ < 1 || txs[i].n_slots_ > Txn::MAX_SLOTS) {
+        throw std::invalid_argument("Transactions access between 1 and MAX_SLOTS slots");
+      }
+      check_slots(txs[i].slots_, txs[i].n_slots_);
+      reqs[i] = Request{procedure_of(txs[i].type_), {}, txs[i].n_slots_, nullptr};
+      std::copy(txs[i].slots_, txs[i].slots_ + txs[i].n_slots_, reqs[i].slots_);
+    }
+    for (const auto& req : reqs) {
+      engine_.execute(req);
+    }
+  }
+
+  void Adapter::read(const int* slots, int n, int* out) {
+    check_slots(slots, n);
+    for (int i = 0; i < n; i += Txn::MAX_SLOTS) {
+      engine_.read(slots + i, std::min(Txn::MAX_SLOTS, n - i), out + i);
+    }
+  }
+
+  void Adapter::check_slots(const int* slots, int n) const {
+    for (int i = 0; i < n; i++) {
+      if (slots[i] < 0 || slots[i] >= engine_.size()) {
+        throw std::invalid_argument("Transaction accesses a slot out of the table");
+      }
+    }
+  }
+
+  // Slot by slot, in transactions of MAX_SLOTS slots: holding the locks of
+  // the whole range would stall every writer
+  void Adapter::scan(int begin, int end, int* out) {
+    int slots[Txn::MAX_SLOTS];
+    for (int i = begin; i < end; i += Txn::MAX_SLOTS) {
+      int n = std::min(Txn::MAX_SLOTS, end - i);
+      std::iota(slots, slots + n, i);
+      engine_.read(slots, n, out + (i - begin));
+    }
+  }
+
+  void Adapter::shutdown() {}
+
+} // namespace twopc
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../engine.h"
+#include "2pc_engine.h"
+
+namespace twopc {
+
+  // The engine behind the common interface (see engines::Engine).
+  // Transactions run on the thread which submits them
+  class Adapter : public engines::Engine {
+    public:
+      // Every slot starts out as 1
+      Adapter(int n_slots);
+
+      const char* name() const override;
+      bool durable() const override;
+      void submit(const engines::Tx* txs, int n) override;
+      void read(const int* slots, int n, int* out) override;
+      void scan(int begin, int end, int* out) override;
+      void shutdown() override;
+
+    private:
+      // Throws std::invalid_argument for slots out of the table
+      void check_slots(const int* slots, int n) const;
+
+      twopc::Engine engine_;
+  };
+
+} // namespace twopc
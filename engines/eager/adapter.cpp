@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "adapter.h"
+#include "../procedures.h"
+
+namespace eager {
+
+  namespace {
+    Procedure procedure_of(engines::TxType type) {
+      switch (type) {
+        case engines::TxType::INCREMENT:
+          return engines::increment<Txn>;
+      }
+      throw std::invalid_argument("Unknown transaction type");
+    }
+  }
+
+  Adapter::Adapter(int n_slots, int cores): engine_(std::vector<int>(n_slots, 1), cores) {
+    engine_.start();
+  }
+
+  Adapter::~Adapter() {
+    shutdown();
+  }
+
+  const char* Adapter::name() const {
+    return "eager";
+  }
+
+  bool Adapter::durable() const {
+    return false;
+  }
+
+  // Queued all at once, so that the cores of the batch work in parallel.
+  // The whole batch is checked first: nothing may be queued once a request
+  // turns out to be invalid, the engine would outlive reqs and done
+  void Adapter::submit(const engines::Tx* txs, int n) {
+    std::vector<Request> reqs(n);
+    std::vector<Completion> done(n);
+    for (int i = 0; i < n; i++) {
+      if (txs[i].n_slots_ < 1 || txs[i].n_slots_ > MAX_SLOTS) {
+        throw std::invalid_argument("Requests access between 1 and MAX_SLOTS slots");
+      }
+      for (int j = 0; j < txs[i].n_slots_; j++) {
+        if (txs[i].slots_[j] < 0 || txs[i].slots_[j] >= engine_.size()) {
+          throw std::invalid_argument("Request accesses a slot out of the table");
+        }
+      }
+      reqs[i] = Request{procedure_of(txs[i].type_), {}, txs[i].n_slots_, nullptr};
+      std::copy(txs[i].slots_, txs[i].slots_ + txs[i].n_slots_, reqs[i].slots_);
+    }
+    for (int i = 0; i < n; i++) {
+      engine_.submit(&reqs[i], &done[i]);
+    }
+    for (const auto& d : done) {
+      d.wait();
+    }
+  }
+
+  void Adapter::read(const int* slots, int n, int* out) {
+    for (int i = 0; i < n; i += MAX_SLOTS) {
+      engine_.read(slots + i, std::min(MAX_SLOTS, n - i), out + i);
+    }
+  }
+
+  // MAX_SLOTS at a time, which mostly stay within one region
+  void Adapter::scan(int begin, int end, int* out) {
+    int slots[MAX_SLOTS];
+    for (int i = begin; i < end; i += MAX_SLOTS) {
+      int n = std::min(MAX_SLOTS, end - i);
+      std::iota(slots, slots + n, i);
+      engine_.read(slots, n, out + (i - begin));
+    }
+  }
+
+  void Adapter::shutdown() {
+    engine_.stop();
+  }
+
+} // namespace eager
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../engine.h"
+#include "eager_engine.h"
+
+namespace eager {
+
+  // The engine behind the common interface (see engines::Engine). The
+  // executors run from construction to shutdown
+  class Adapter : public engines::Engine {
+    public:
+      // Every slot starts out as 1, in one region per core
+      Adapter(int n_slots, int cores);
+      ~Adapter();
+
+      const char* name() const override;
+      bool durable() const override;
+      void submit(const engines::Tx* txs, int n) override;
+      void read(const int* slots, int n, int* out) override;
+      void scan(int begin, int end, int* out) override;
+      void shutdown() override;
+
+    private:
+      eager::Engine engine_;
+  };
+
+} // namespace eager
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "eager_engine.h"
+#include "../lazy/completion.h"
+
+namespace eager {
+
+  namespace {
+    void pin(int core) {
+#ifdef __linux__
+      unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(core % cores, &set);
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+      (void) core;
+#endif
+    }
+
+    void read_slots(Txn& tx, const int* slots, int n, int* out) {
+      for (int i = 0; i < n; i++) {
+        out[i] = tx.read(slots[i]);
+      }
+    }
+
+    // Spins a little, then yields the core: on machines with fewer cores
+    // than executors the thread we wait for may need ours
+    void backoff(int& spins) {
+      if (++spins < lazy::completion::SPINS) {
+        lazy::completion::cpu_relax();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void Completion::wait() const {
+    int spins = 0;
+    while (!done_.load(std::memory_order_acquire)) {
+      backoff(spins);
+    }
+  }
+
+  int Txn::owner(int slot) const {
+    int p = home_.engine_.partition_of(slot);
+    for (int i = 0; i < n_; i++) {
+      if (partitions_[i] == p) {
+        return p;
+      }
+    }
+    throw std::logic_error("Transaction accesses a slot outside the regions of its request");
+  }
+
+  int Txn::read(int slot) {
+    int p = owner(slot);
+    if (p == home_.id_) {
+      return home_.engine_.values_[slot];
+    }
+    home_.send(p, Message{Message::READ, home_.id_, slot, 0, nullptr, nullptr});
+    return home_.await(p, Message::bit(Message::VALUE)).val_;
+  }
+
+  void Txn::write(int slot, int val) {
+    int p = owner(slot);
+    if (p == home_.id_) {
+      home_.engine_.values_[slot] = val;
+      return;
+    }
+    // No reply needed: the owner serves our messages in order, so the write
+    // is done before anything we send afterwards
+    home_.send(p, Message{Message::WRITE, home_.id_, slot, val, nullptr, nullptr});
+  }
+
+  Executor::Executor(Engine& engine, int id, std::size_t mailbox)
+    : engine_(engine), id_(id), mailbox_(mailbox), stop_(false), single_(0), multi_(0), messages_(0) {}
+
+  void Executor::start() {
+    stop_.store(false);
+    thread_ = std::thread(&Executor::run, this);
+  }
+
+  void Executor::stop() {
+    stop_.store(true, std::memory_order_release);
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void Executor::run() {
+    pin(id_);
+    int spins = 0;
+    while (true) {
+      Message m;
+      bool got = false;
+      if (!backlog_.empty()) {
+        m = backlog_.front();
+        backlog_.pop_front();
+        got = true;
+      } else {
+        got = receive(m);
+      }
+      if (got) {
+        serve(m);
+        spins = 0;
+      } else if (stop_.load(std::memory_order_acquire)) {
+        break;
+      } else {
+        backoff(spins);
+      }
+    }
+  }
+
+  void Executor::serve(const Message& m) {
+    switch (m.type_) {
+      case Message::SUBMIT:
+        execute(m.req_, m.done_);
+        break;
+      case Message::RESERVE:
+        hold(m.from_);
+        break;
+      default:
+        throw std::logic_error("Message outside of a transaction");
+    }
+  }
+
+  void Executor::execute(const Request* req, Completion* done) {
+    int partitions[MAX_SLOTS] = {};
+    int n = 0;
+    for (int i = 0; i < req->n_slots_; i++) {
+      int p = engine_.partition_of(req->slots_[i]);
+      if (std::find(partitions, partitions + n, p) == partitions + n) {
+        partitions[n++] = p;
+      }
+    }
+    std::sort(partitions, partitions + n);
+    if (partitions[0] != id_) {
+      throw std::logic_error("Request submitted to the wrong core");
+    }
+
+    Txn tx(*this, partitions, n);
+    if (n == 1) {
+      req->proc_(tx, req->slots_, req->n_slots_, req->out_);
+      single_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      for (int i = 1; i < n; i++) {
+        send(partitions[i], Message{Message::RESERVE, id_, 0, 0, nullptr, nullptr});
+        await(partitions[i], Message::bit(Message::RESERVED));
+      }
+      req->proc_(tx, req->slots_, req->n_slots_, req->out_);
+      for (int i = 1; i < n; i++) {
+        send(partitions[i], Message{Message::RELEASE, id_, 0, 0, nullptr, nullptr});
+      }
+      multi_.fetch_add(1, std::memory_order_relaxed);
+    }
+    done->finished_ = std::chrono::steady_clock::now();
+    done->done_.store(1, std::memory_order_release);
+    engine_.completed_.fetch_add(1, std::memory_order_release);
+  }
+
+  void Executor::hold(int from) {
+    send(from, Message{Message::RESERVED, id_, 0, 0, nullptr, nullptr});
+    while (true) {
+      Message m = await(from, Message::bit(Message::READ) | Message::bit(Message::WRITE) |
+                              Message::bit(Message::RELEASE));
+      switch (m.type_) {
+        case Message::READ:
+          send(from, Message{Message::VALUE, id_, m.slot_, engine_.values_[m.slot_], nullptr, nullptr});
+          break;
+        case Message::WRITE:
+          engine_.values_[m.slot_] = m.val_;
+          break;
+        case Message::RELEASE:
+          return;
+        default:
+          throw std::logic_error("Unexpected message in a reserved region");
+      }
+    }
+  }
+
+  bool Executor::receive(Message& m) {
+    if (!spilled_.empty()) {
+      m = spilled_.front();
+      spilled_.pop_front();
+      return true;
+    }
+    return mailbox_.try_pop(m);
+  }
+
+  Message Executor::await(int from, unsigned types) {
+    int spins = 0;
+    while (true) {
+      Message m;
+      if (!receive(m)) {
+        backoff(spins);
+        continue;
+      }
+      spins = 0;
+      if (m.from_ == from && (Message::bit(m.type_) & types)) {
+        return m;
+      }
+      backlog_.push_back(m);
+    }
+  }
+
+  // Two cores sending to each other's full mailboxes would wait forever,
+  // so while waiting we empty ours into spilled_
+  void Executor::send(int to, const Message& m) {
+    auto& box = engine_.executors_[to]->mailbox_;
+    int spins = 0;
+    while (!box.try_push(m)) {
+      Message in;
+      if (mailbox_.try_pop(in)) {
+        spilled_.push_back(in);
+      } else {
+        backoff(spins);
+      }
+    }
+    messages_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Engine::Engine(std::vector<int>&& data, int partitions)
+    : values_(std::move(data)), partitions_(partitions), submitted_(0), completed_(0) {
+    if (partitions < 1 || values_.empty()) {
+      throw std::invalid_argument("The engine needs at least one region and one slot");
+    }
+    span_ = (static_cast<int>(values_.size()) + partitions - 1) / partitions;
+    for (int i = 0; i < partitions; i++) {
+      executors_.push_back(std::make_unique<Executor>(*this, i, MAILBOX));
+    }
+  }
+
+  Engine::~Engine() {
+    stop();
+  }
+
+  void Engine::start() {
+    for (auto& e : executors_) {
+      e->start();
+    }
+  }
+
+  void Engine::submit(const Request* req, Completion* done) {
+    if (req->n_slots_ < 1 || req->n_slots_ > MAX_SLOTS) {
+      throw std::invalid_argument("Requests access between 1 and MAX_SLOTS slots");
+    }
+    int lowest = partitions_;
+    for (int i = 0; i < req->n_slots_; i++) {
+      if (req->slots_[i] < 0 || req->slots_[i] >= size()) {
+        throw std::invalid_argument("Request accesses a slot out of the table");
+      }
+      lowest = std::min(lowest, partition_of(req->slots_[i]));
+    }
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    auto& box = executors_[lowest]->mailbox_;
+    Message m{Message::SUBMIT, -1, 0, 0, req, done};
+    int spins = 0;
+    while (!box.try_push(m)) {
+      backoff(spins);
+    }
+  }
+
+  void Engine::read(const int* slots, int n, int* out) {
+    if (n < 1 || n > MAX_SLOTS) {
+      throw std::invalid_argument("Requests access between 1 and MAX_SLOTS slots");
+    }
+    Request req{read_slots, {}, n, out};
+    std::copy(slots, slots + n, req.slots_);
+    Completion done;
+    submit(&req, &done);
+    done.wait();
+  }
+
+  void Engine::stop() {
+    // Cores still exchange messages for the requests in flight
+    int spins = 0;
+    while (completed_.load(std::memory_order_acquire) < submitted_.load(std::memory_order_relaxed)) {
+      backoff(spins);
+    }
+    for (auto& e : executors_) {
+      e->stop();
+    }
+  }
+
+  int Engine::partitions() const {
+    return partitions_;
+  }
+
+  int Engine::partition_of(int slot) const {
+    return slot / span_;
+  }
+
+  int Engine::first_slot(int partition) const {
+    return partition * span_;
+  }
+
+  int Engine::value(int slot) const {
+    return values_[slot];
+  }
+
+  int Engine::size() const {
+    return values_.size();
+  }
+
+  int64_t Engine::checksum() const {
+    int64_t sum = 0;
+    for (int v : values_) {
+      sum += v;
+    }
+    return sum;
+  }
+
+  Engine::Stats Engine::stats() const {
+    Stats s{0, 0, 0};
+    for (const auto& e : executors_) {
+      s.single_ += e->single_.load(std::memory_order_relaxed);
+      s.multi_ += e->multi_.load(std::memory_order_relaxed);
+      s.messages_ += e->messages_.load(std::memory_order_relaxed);
+    }
+    return s;
+  }
+
+} // namespace eager
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "mailbox.h"
+
+/*
+  Partitioned execution (see tactic): the slots are split into one
+  contiguous region per core, and only the core which owns a region ever
+  touches it.
+*/
+
+namespace eager {
+
+  class Engine;
+  class Executor;
+
+  // Distinct slots one request can access
+  constexpr int MAX_SLOTS = 16;
+
+  // Set by the engine once a request is done
+  struct Completion {
+    std::atomic<uint32_t> done_{0};
+    std::chrono::steady_clock::time_point finished_;
+
+    void wait() const;
+  };
+
+  // A transaction while it runs on the core of the lowest region it
+  // accesses. Slots of that region are accessed directly, slots of other
+  // regions are shipped to their owners, which only serve this transaction
+  // until it is done.
+  class Txn {
+    public:
+      // Throws std::logic_error for slots outside the regions of the request
+      int read(int slot);
+      void write(int slot, int val);
+
+    private:
+      friend class Executor;
+
+      Txn(Executor& home, const int* partitions, int n): home_(home), partitions_(partitions), n_(n) {}
+
+      int owner(int slot) const;
+
+      Executor& home_;
+      // Regions the transaction holds, home first
+      const int* partitions_;
+      int n_;
+  };
+
+  // Stored procedure: the code of a transaction type, run on the n slots
+  // it is given, which puts its results (if any) in out. Must only access
+  // those slots
+  using Procedure = void (*)(Txn& tx, const int* slots, int n, int* out);
+
+  struct Request {
+    Procedure proc_;
+    int slots_[MAX_SLOTS];
+    int n_slots_;
+    // nullptr for transactions without results
+    int* out_;
+  };
+
+  struct Message {
+    enum Type : int32_t {
+      // From clients: run req_ and signal done_
+      SUBMIT,
+      // Serve only the sender until it releases
+      RESERVE,
+      RESERVED,
+      READ,
+      VALUE,
+      WRITE,
+      RELEASE
+    };
+
+    static constexpr unsigned bit(Type t) { return 1u << t; }
+
+    Type type_;
+    // Core of the sender, -1 for clients
+    int from_;
+    int slot_;
+    int val_;
+    const Request* req_;
+    Completion* done_;
+  };
+
+  // The thread of one core, and the only one to touch its region.
+  //
+  // A multi-region transaction runs on the core of its lowest region,
+  // which first reserves the other regions in ascending order (and waits
+  // for each of them to confirm), then ships them its reads and writes,
+  // then releases them. A reserved core, like a core waiting for a reply,
+  // keeps taking messages off its mailbox but puts aside everything which
+  // is not from the transaction it serves, and goes through it once it is
+  // free again. A core only ever waits for higher regions than the ones it
+  // holds, so there is no cycle of waits.
+  class Executor {
+    public:
+      Executor(Engine& engine, int id, std::size_t mailbox);
+      Executor(const Executor& other) = delete;
+
+      void start();
+      // Returns once its mailbox is empty and it serves nobody
+      void stop();
+
+    private:
+      friend class Txn;
+      friend class Engine;
+
+      void run();
+      void serve(const Message& m);
+      void execute(const Request* req, Completion* done);
+      // Serves the transaction running on core from, until it releases
+      void hold(int from);
+      // Next message in arrival order
+      bool receive(Message& m);
+      // Next message from core from of one of the types (Message::bit),
+      // putting aside the others
+      Message await(int from, unsigned types);
+      void send(int to, const Message& m);
+
+      Engine& engine_;
+      int id_;
+      Mailbox<Message> mailbox_;
+      // Taken off the mailbox while waiting to send
+      std::deque<Message> spilled_;
+      // Put aside while the core was busy with another transaction
+      std::deque<Message> backlog_;
+      std::atomic<bool> stop_;
+      std::thread thread_;
+
+      std::atomic<long> single_;
+      std::atomic<long> multi_;
+      std::atomic<long> messages_;
+  };
+
+  // Partitioned engine without locks or latches on the data: every slot
+  // belongs to the region of one core, single-region transactions run
+  // serially on their core, and multi-region ones as above.
+  class Engine {
+    public:
+      static constexpr std::size_t MAILBOX = 1 << 14;
+
+      struct Stats {
+        long single_;
+        long multi_;
+        long messages_;
+      };
+
+      Engine(std::vector<int>&& data, int partitions);
+      Engine(const Engine& other) = delete;
+      ~Engine();
+
+      // Starts one executor per region, pinned to its core
+      void start();
+      // Queues req on the core of its lowest region. req must stay alive
+      // until done. Throws std::invalid_argument for requests of no slots,
+      // more than MAX_SLOTS or slots out of the table. Thread-safe
+      void submit(const Request* req, Completion* done);
+      // Committed values of up to MAX_SLOTS slots, read by a transaction.
+      // Thread-safe
+      void read(const int* slots, int n, int* out);
+      // Waits for everything submitted, then stops the executors
+      void stop();
+
+      int partitions() const;
+      int partition_of(int slot) const;
+      // First slot of the region
+      int first_slot(int partition) const;
+      // A committed value. Only consistent while the executors are stopped
+      int value(int slot) const;
+      int size() const;
+      int64_t checksum() const;
+      Stats stats() const;
+
+    private:
+      friend class Executor;
+      friend class Txn;
+
+      std::vector<int> values_;
+      int partitions_;
+      // Slots per region
+      int span_;
+      std::vector<std::unique_ptr<Executor>> executors_;
+      std::atomic<long> submitted_;
+      std::atomic<long> completed_;
+  };
+
+} // namespace eager
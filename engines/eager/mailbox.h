@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace eager {
+
+  // Bounded lock-free queue with any number of producers and a single
+  // consumer (the core which owns it). Every cell carries a sequence number
+  // telling whose turn it is: producers claim a position with a CAS on the
+  // tail and publish the cell by bumping its sequence, the consumer takes
+  // cells in order without any atomic read-modify-write.
+  template<typename T>
+  class Mailbox {
+    public:
+      // capacity must be a power of 2
+      explicit Mailbox(std::size_t capacity): cells_(new Cell[capacity]), mask_(capacity - 1), head_(0), tail_(0) {
+        for (std::size_t i = 0; i < capacity; i++) {
+          cells_[i].seq_.store(i, std::memory_order_relaxed);
+        }
+      }
+      Mailbox(const Mailbox& other) = delete;
+
+      // Thread-safe. Fails if the mailbox is full
+      bool try_push(const T& v) {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+          Cell& c = cells_[pos & mask_];
+          std::size_t seq = c.seq_.load(std::memory_order_acquire);
+          auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+          if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+              c.v_ = v;
+              c.seq_.store(pos + 1, std::memory_order_release);
+              return true;
+            }
+          } else if (diff < 0) {
+            return false;
+          } else {
+            pos = tail_.load(std::memory_order_relaxed);
+          }
+        }
+      }
+
+      // Consumer only. Fails if the mailbox is empty
+      bool try_pop(T& out) {
+        Cell& c = cells_[head_ & mask_];
+        if (c.seq_.load(std::memory_order_acquire) != head_ + 1) {
+          return false;
+        }
+        out = c.v_;
+        c.seq_.store(head_ + mask_ + 1, std::memory_order_release);
+        head_++;
+        return true;
+      }
+
+    private:
+      struct alignas(64) Cell {
+        std::atomic<std::size_t> seq_;
+        T v_;
+      };
+
+      std::unique_ptr<Cell[]> cells_;
+      std::size_t mask_;
+      alignas(64) std::size_t head_;
+      alignas(64) std::atomic<std::size_t> tail_;
+  };
+
+} // namespace eager
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+namespace engines {
+
+  // Distinct slots one transaction of the common workloads can access
+  constexpr int MAX_SLOTS = 16;
+
+  // Transaction types every engine implements, so that the same workload
+  // can be run against all of them
+  enum class TxType : int32_t {
+    // Reads every slot and writes it back incremented by one
+    INCREMENT = 1
+  };
+
+  struct Tx {
+    TxType type_;
+    int slots_[MAX_SLOTS];
+    int n_slots_;
+  };
+
+  // What a benchmark sees of an engine: a table of int slots, transactions
+  // submitted in batches, and client reads.
+  //
+  // Every call may be made by several threads at once, except shutdown(),
+  // after which nothing may be called anymore.
+  class Engine {
+    public:
+      virtual ~Engine() = default;
+
+      virtual const char* name() const = 0;
+      // Whether submit() only returns once the transactions are on disk
+      virtual bool durable() const = 0;
+      // Commits the transactions serializably, but not necessarily in the
+      // order given (the eager engine runs a batch on all of its cores at
+      // once). Returns once every one of them is committed (durable, for
+      // durable() engines)
+      virtual void submit(const Tx* txs, int n) = 0;
+      // Committed values of the slots, into out
+      virtual void read(const int* slots, int n, int* out) = 0;
+      // Committed values of the slots in [begin, end), into out. Only
+      // multi-versioned engines read them as of a single point in time
+      virtual void scan(int begin, int end, int* out) = 0;
+      // Waits for whatever the engine still does in the background (e.g.
+      // substantiation), then stops its threads
+      virtual void shutdown() = 0;
+  };
+
+} // namespace engines
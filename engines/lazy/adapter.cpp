@@ -0,0 +1,184 @@
+#include <cstdio>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "adapter.h"
+#include "interpreter.h"
+#include "linked_table.h"
+#include "tx_template.h"
+
+namespace lazy {
+
+  namespace {
+    using IncrementTx = TxTemplate<3,
+      tx::Const<1, 1>,
+      tx::Read<0, tx::Slot<0>>, tx::Add<0, 0, 1>, tx::Write<tx::Slot<0>, 0>,
+      tx::Read<0, tx::Slot<1>>, tx::Add<0, 0, 1>, tx::Write<tx::Slot<1>, 0>,
+      tx::Read<0, tx::Slot<2>>, tx::Add<0, 0, 1>, tx::Write<tx::Slot<2>, 0>>;
+
+    // Ids in the command log
+    enum AdapterTxType { INCREMENT_TEMPLATE = 1, INCREMENT_PROGRAM = 2 };
+
+    TxTypes adapter_tx_types() {
+      TxTypes types;
+      types.add(INCREMENT_TEMPLATE, &IncrementTx::shape);
+      types.add(INCREMENT_PROGRAM, Interpreter::run);
+      return types;
+    }
+  }
+
+  LinkedTable* Adapter::fresh_state(int n_slots) {
+    if (n_slots > Globals::n_slots) {
+      throw std::invalid_argument("The lazy engine holds at most Globals::n_slots slots");
+    }
+    static std::atomic<bool> made{false};
+    if (made.exchange(true)) {
+      throw std::logic_error("There is only one lazy engine per process");
+    }
+    // Whatever a previous run logged is cleared before the log is opened,
+    // which lists its segments
+    for (const auto& segment : CommandLog::segments(log_file)) {
+      std::remove(segment.path_.c_str());
+    }
+    Globals::table_ = new LinkedTable(std::vector<int>(n_slots, 1));
+    return Globals::table_;
+  }
+
+  Adapter::Adapter(int n_slots, int cores): Adapter(fresh_state(n_slots), cores) {}
+
+  Adapter::Adapter(LinkedTable* table, int cores)
+    : requests_(Globals::huge_pages), types_(adapter_tx_types()), pool_(cores),
+      log_(log_file, types_), sticky_(Globals::sticky_cores, &pool_, &log_),
+      gc_(table, std::chrono::milliseconds(10)),
+      checkpointer_(table, &log_, table_file, std::chrono::milliseconds(50)),
+      committed_(constants::T0), shut_down_(false) {
+    gc_.start();
+    checkpointer_.start();
+  }
+
+  Adapter::~Adapter() {
+    shutdown();
+  }
+
+  const char* Adapter::name() const {
+    return "lazy";
+  }
+
+  bool Adapter::durable() const {
+    return true;
+  }
+
+  void Adapter::check(const engines::Tx& tx) {
+    if (tx.type_ != engines::TxType::INCREMENT) {
+      throw std::invalid_argument("Unknown transaction type");
+    }
+    if (tx.n_slots_ < 1 || tx.n_slots_ > engines::MAX_SLOTS) {
+      throw std::invalid_argument("Transactions access between 1 and MAX_SLOTS slots");
+    }
+    for (int i = 0; i < tx.n_slots_; i++) {
+      if (tx.slots_[i] < 0 || tx.slots_[i] >= Globals::table_->rows()) {
+        throw std::invalid_argument("Transaction accesses a slot out of the table");
+      }
+    }
+  }
+
+  Request* Adapter::make(const engines::Tx& tx, Time epoch) {
+    Span<const int> slots(tx.slots_, tx.n_slots_);
+    if (tx.n_slots_ == 3) {
+      return Request::make(requests_, true, &IncrementTx::shape, slots, epoch);
+    }
+    std::vector<Operation> ops{Operation::constant(1, 1)};
+    for (int slot : slots) {
+      ops.push_back(Operation::read(0, slot));
+      ops.push_back(Operation::add(0, 0, 1));
+      ops.push_back(Operation::write(slot, 0));
+    }
+    return Request::make(requests_, true, Interpreter::run, ops, epoch);
+  }
+
+  void Adapter::submit(const engines::Tx* txs, int n) {
+    if (n == 0) {
+      return;
+    }
+    // Checked before any epoch is leased: a request failing to be made
+    // afterwards would leave a hole in the committed epochs
+    for (int i = 0; i < n; i++) {
+      check(txs[i]);
+    }
+    // The pool may substantiate the batch (and newer ones) before it is
+    // durable: the pin keeps the version gc low-watermark from getting past
+    // the committed epoch meanwhile, so that readers can always pin it
+    std::optional<Reclaimer::Pin> pin;
+    pin_committed(pin);
+    Time last;
+    {
+      std::scoped_lock<std::mutex> lock(submit_lock_);
+      // The status words of Globals::tx_state_ are not recycled: once they
+      // run out, the batch is refused before any of its epochs is leased
+      if (n > TxStateTable::MAX_EPOCHS - 1 - Globals::clock_.time()) {
+        throw std::out_of_range("The batch does not fit in the epochs of the transaction state table");
+      }
+      // Epochs of the calling thread's lease could be older than the
+      // batches of other threads, the batch gets its own instead
+      Time first = Globals::clock_.lease(n);
+      std::vector<Request*> reqs;
+      reqs.reserve(n);
+      for (int i = 0; i < n; i++) {
+        reqs.push_back(make(txs[i], first + i));
+      }
+      Globals::dep_.add_txs(reqs);
+      Globals::txs_.add(reqs);
+      sticky_.stickify(reqs);
+      last = reqs.back()->time();
+    }
+    // Batches are logged in the order they are stickified, so once this one
+    // is durable every older batch is as well (and stickified already).
+    // Other batches are stickified meanwhile
+    log_.wait_durable(last);
+    Time committed = committed_.load(std::memory_order_relaxed);
+    while (committed < last && !committed_.compare_exchange_weak(committed, last, std::memory_order_release)) {}
+  }
+
+  Time Adapter::pin_committed(std::optional<Reclaimer::Pin>& pin) {
+    while (true) {
+      Time t = committed_.load(std::memory_order_acquire);
+      try {
+        pin.emplace(Globals::reclaimer_, t);
+        return t;
+      } catch (const std::runtime_error&) {
+        // The gc got past t after a newer batch was committed, which we
+        // read instead
+      }
+    }
+  }
+
+  void Adapter::read(const int* slots, int n, int* out) {
+    std::optional<Reclaimer::Pin> pin;
+    Time t = pin_committed(pin);
+    Globals::table_->read_as_of(0, t, Span<const int>(slots, n), out);
+  }
+
+  void Adapter::scan(int begin, int end, int* out) {
+    std::optional<Reclaimer::Pin> pin;
+    Time t = pin_committed(pin);
+    Globals::table_->scan<int32_t>(0, t, begin, end, out);
+  }
+
+  void Adapter::shutdown() {
+    if (shut_down_) {
+      return;
+    }
+    shut_down_ = true;
+    pool_.wait_idle();
+    pool_.shutdown();
+    checkpointer_.stop();
+    gc_.stop();
+    log_.close();
+    Globals::shutdown();
+    Globals::table_ = nullptr;
+    // Every request is substantiated, and none is reachable anymore
+    Globals::txs_ = TxCollection();
+  }
+
+} // namespace lazy
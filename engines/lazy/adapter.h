@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+
+#include "../engine.h"
+#include "checkpointer.h"
+#include "command_log.h"
+#include "execution_worker.h"
+#include "reclaim.h"
+#include "request.h"
+#include "stickifier.h"
+#include "tx_types.h"
+#include "version_gc.h"
+
+namespace lazy {
+
+  // The engine behind the common interface (see engines::Engine).
+  //
+  // A batch is committed like lazy::run commits its requests: admitted at
+  // consecutive epochs, stickified (which logs their commands) and
+  // acknowledged once the log is durable up to the last one; substantiation
+  // is left to the execution pool and to the reads. Batches are stickified
+  // one at a time, in the order they are submitted, but wait for the log
+  // outside of that, so that the next ones are stickified meanwhile and
+  // share its group commits. Reads and scans are of the newest committed
+  // epoch.
+  //
+  // The engine keeps its state in Globals, so there is at most one Adapter
+  // per process, and no lazy::run next to it.
+  class Adapter : public engines::Engine {
+    public:
+      // Command log and checkpoints, apart from the ones of lazy::run since
+      // their transaction types differ
+      static constexpr const char* log_file = "lazy_bench.wal";
+      static constexpr const char* table_file = "lazy_bench.col";
+
+      // Every slot starts out as 1. Throws std::invalid_argument for more
+      // slots than Globals::n_slots (the size of the dependency graph), and
+      // std::logic_error for a second Adapter
+      Adapter(int n_slots, int cores);
+      ~Adapter();
+
+      const char* name() const override;
+      bool durable() const override;
+      // Throws std::out_of_range, without committing any of the batch, once
+      // the epochs of Globals::tx_state_ run out
+      void submit(const engines::Tx* txs, int n) override;
+      void read(const int* slots, int n, int* out) override;
+      void scan(int begin, int end, int* out) override;
+      void shutdown() override;
+
+    private:
+      // Everything the members are made from, in order: checks the
+      // arguments, clears the log of a previous run and makes the table
+      static LinkedTable* fresh_state(int n_slots);
+      Adapter(LinkedTable* table, int cores);
+
+      // Throws std::invalid_argument for transactions make would reject
+      static void check(const engines::Tx& tx);
+      Request* make(const engines::Tx& tx, Time epoch);
+      // Pins the newest committed epoch (see submit) and returns it
+      Time pin_committed(std::optional<Reclaimer::Pin>& pin);
+
+      // Released last: everything below may still lead to its requests
+      RequestPool requests_;
+      TxTypes types_;
+      ExecutionPool pool_;
+      CommandLog log_;
+      // Its threads stay around between batches
+      StickificationLayer sticky_;
+      VersionGC gc_;
+      Checkpointer checkpointer_;
+
+      // Held while a batch is admitted and stickified
+      std::mutex submit_lock_;
+      // Every batch up to this epoch is stickified and durable
+      std::atomic<Time> committed_;
+      bool shut_down_;
+  };
+
+} // namespace lazy
@@ -0,0 +1,344 @@
+#include <sys/mman.h>
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "arena.h"
+
+namespace lazy {
+
+  namespace {
+    constexpr std::size_t HUGE_PAGE = 2 << 20;
+    // How many arenas a thread keeps a slab of at the same time
+    constexpr int CACHED_ARENAS = 4;
+  }
+
+  Region::Region(std::size_t bytes, bool huge_pages) {
+    if (bytes == 0) {
+      return;
+    }
+    if (huge_pages) {
+      std::size_t rounded = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+      void* p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED) {
+        data_ = p;
+        size_ = rounded;
+        return;
+      }
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    if (huge_pages) {
+      madvise(p, bytes, MADV_HUGEPAGE);
+    }
+    data_ = p;
+    size_ = bytes;
+  }
+
+  Region::Region(Region&& other): data_(other.data_), size_(other.size_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+
+  Region& Region::operator=(Region&& other) {
+    if (this != &other) {
+      release();
+      data_ = other.data_;
+      size_ = other.size_;
+      other.data_ = nullptr;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+
+  void* Region::data() const {
+    return data_;
+  }
+
+  std::size_t Region::size() const {
+    return size_;
+  }
+
+  void Region::release() {
+    if (data_) {
+      munmap(data_, size_);
+      data_ = nullptr;
+      size_ = 0;
+    }
+  }
+
+  Region::~Region() {
+    release();
+  }
+
+  namespace {
+    // Unused end of a slab
+    struct Tail {
+      char* cur_;
+      char* end_;
+    };
+
+    // Moves a tail with room for bytes off tails into [cur, end)
+    bool take_tail(std::vector<Tail>& tails, std::size_t bytes, char*& cur, char*& end) {
+      for (std::size_t i = tails.size(); i-- > 0;) {
+        if (tails[i].cur_ + bytes <= tails[i].end_) {
+          cur = tails[i].cur_;
+          end = tails[i].end_;
+          tails[i] = tails.back();
+          tails.pop_back();
+          return true;
+        }
+      }
+      return false;
+    }
+  }
+
+  struct SlabArena::Shared {
+    struct FreeBatch {
+      void* head_;
+      int count_;
+    };
+
+    explicit Shared(std::size_t object_size): object_size_(object_size) {}
+
+    std::size_t object_size_;
+    std::mutex lock_;
+    // Cleared when the arena is destroyed: thread caches which still point
+    // here then drop what they have left
+    bool alive_ = true;
+    std::vector<Region> slabs_;
+    std::vector<Tail> tails_;
+    // Free lists handed back by the threads, of FREE_BATCH objects each
+    // (fewer for the ones of exited threads)
+    std::vector<FreeBatch> free_batches_;
+    std::atomic<int> n_free_batches_{0};
+  };
+
+  struct SlabArena::ThreadCache {
+    struct FreeObject {
+      FreeObject* next_;
+    };
+
+    std::shared_ptr<Shared> arena_;
+    char* cur_ = nullptr;
+    char* end_ = nullptr;
+    FreeObject* free_ = nullptr;
+    int free_count_ = 0;
+
+    ~ThreadCache() {
+      give_back();
+    }
+
+    // Hands the rest of the slab and the free list back to the arena, and
+    // forgets it
+    void give_back() {
+      if (!arena_) {
+        return;
+      }
+      {
+        std::scoped_lock<std::mutex> lock(arena_->lock_);
+        if (arena_->alive_) {
+          if (cur_ + arena_->object_size_ <= end_) {
+            arena_->tails_.push_back(Tail{cur_, end_});
+          }
+          if (free_) {
+            arena_->free_batches_.push_back(Shared::FreeBatch{free_, free_count_});
+            arena_->n_free_batches_.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      }
+      arena_.reset();
+      cur_ = nullptr;
+      end_ = nullptr;
+      free_ = nullptr;
+      free_count_ = 0;
+    }
+  };
+
+  SlabArena::SlabArena(std::size_t object_size, bool huge_pages)
+    : object_size_(object_size), huge_pages_(huge_pages), shared_(std::make_shared<Shared>(object_size)) {}
+
+  SlabArena::~SlabArena() {
+    std::scoped_lock<std::mutex> lock(shared_->lock_);
+    shared_->alive_ = false;
+    shared_->slabs_.clear();
+    shared_->tails_.clear();
+    shared_->free_batches_.clear();
+  }
+
+  SlabArena::ThreadCache& SlabArena::local() {
+    thread_local ThreadCache caches[CACHED_ARENAS];
+    thread_local int victim = 0;
+    for (auto& cache : caches) {
+      if (cache.arena_ == shared_) {
+        return cache;
+      }
+    }
+    auto& cache = caches[victim];
+    victim = (victim + 1) % CACHED_ARENAS;
+    cache.give_back();
+    cache.arena_ = shared_;
+    return cache;
+  }
+
+  void* SlabArena::allocate() {
+    auto& cache = local();
+    auto& shared = *shared_;
+    if (!cache.free_ && shared.n_free_batches_.load(std::memory_order_relaxed) > 0) {
+      std::scoped_lock<std::mutex> lock(shared.lock_);
+      if (!shared.free_batches_.empty()) {
+        cache.free_ = static_cast<ThreadCache::FreeObject*>(shared.free_batches_.back().head_);
+        cache.free_count_ = shared.free_batches_.back().count_;
+        shared.free_batches_.pop_back();
+        shared.n_free_batches_.fetch_sub(1, std::memory_order_relaxed);
+      }
+    }
+    if (cache.free_) {
+      auto* obj = cache.free_;
+      cache.free_ = obj->next_;
+      cache.free_count_--;
+      std::memset(static_cast<void*>(obj), 0, object_size_);
+      return obj;
+    }
+    if (cache.cur_ + object_size_ > cache.end_) {
+      std::unique_lock<std::mutex> lock(shared.lock_);
+      if (!take_tail(shared.tails_, object_size_, cache.cur_, cache.end_)) {
+        lock.unlock();
+        Region slab(SLAB_BYTES, huge_pages_);
+        cache.cur_ = static_cast<char*>(slab.data());
+        cache.end_ = cache.cur_ + slab.size();
+        lock.lock();
+        shared.slabs_.push_back(std::move(slab));
+      }
+    }
+    void* obj = cache.cur_;
+    cache.cur_ += object_size_;
+    return obj;
+  }
+
+  void SlabArena::deallocate(void* obj) {
+    auto& cache = local();
+    auto* free_obj = static_cast<ThreadCache::FreeObject*>(obj);
+    free_obj->next_ = cache.free_;
+    cache.free_ = free_obj;
+    if (++cache.free_count_ == FREE_BATCH) {
+      std::scoped_lock<std::mutex> lock(shared_->lock_);
+      shared_->free_batches_.push_back(Shared::FreeBatch{cache.free_, cache.free_count_});
+      shared_->n_free_batches_.fetch_add(1, std::memory_order_relaxed);
+      cache.free_ = nullptr;
+      cache.free_count_ = 0;
+    }
+  }
+
+  std::size_t SlabArena::reserved_bytes() const {
+    std::scoped_lock<std::mutex> lock(shared_->lock_);
+    std::size_t total = 0;
+    for (const auto& slab : shared_->slabs_) {
+      total += slab.size();
+    }
+    return total;
+  }
+
+  struct BumpArena::Shared {
+    std::mutex lock_;
+    // See SlabArena::Shared
+    bool alive_ = true;
+    std::vector<Region> slabs_;
+    std::vector<Tail> tails_;
+  };
+
+  struct BumpArena::ThreadCache {
+    // Ends shorter than this are not worth handing back
+    static constexpr std::size_t MIN_TAIL = 256;
+
+    std::shared_ptr<Shared> arena_;
+    char* cur_ = nullptr;
+    char* end_ = nullptr;
+
+    ~ThreadCache() {
+      give_back();
+    }
+
+    void give_back() {
+      if (!arena_) {
+        return;
+      }
+      {
+        std::scoped_lock<std::mutex> lock(arena_->lock_);
+        if (arena_->alive_ && cur_ + MIN_TAIL <= end_) {
+          arena_->tails_.push_back(Tail{cur_, end_});
+        }
+      }
+      arena_.reset();
+      cur_ = nullptr;
+      end_ = nullptr;
+    }
+  };
+
+  BumpArena::BumpArena(bool huge_pages): huge_pages_(huge_pages), shared_(std::make_shared<Shared>()) {}
+
+  BumpArena::~BumpArena() {
+    std::scoped_lock<std::mutex> lock(shared_->lock_);
+    shared_->alive_ = false;
+    shared_->slabs_.clear();
+    shared_->tails_.clear();
+  }
+
+  BumpArena::ThreadCache& BumpArena::local() {
+    thread_local ThreadCache caches[CACHED_ARENAS];
+    thread_local int victim = 0;
+    for (auto& cache : caches) {
+      if (cache.arena_ == shared_) {
+        return cache;
+      }
+    }
+    auto& cache = caches[victim];
+    victim = (victim + 1) % CACHED_ARENAS;
+    cache.give_back();
+    cache.arena_ = shared_;
+    return cache;
+  }
+
+  void* BumpArena::allocate(std::size_t bytes) {
+    bytes = (bytes + ALIGN - 1) / ALIGN * ALIGN;
+    auto& shared = *shared_;
+    if (bytes > MAX_SMALL) {
+      Region big(bytes, huge_pages_);
+      void* obj = big.data();
+      std::scoped_lock<std::mutex> lock(shared.lock_);
+      shared.slabs_.push_back(std::move(big));
+      return obj;
+    }
+    auto& cache = local();
+    if (cache.cur_ + bytes > cache.end_) {
+      std::unique_lock<std::mutex> lock(shared.lock_);
+      if (!take_tail(shared.tails_, bytes, cache.cur_, cache.end_)) {
+        lock.unlock();
+        Region slab(SLAB_BYTES, huge_pages_);
+        cache.cur_ = static_cast<char*>(slab.data());
+        cache.end_ = cache.cur_ + slab.size();
+        lock.lock();
+        shared.slabs_.push_back(std::move(slab));
+      }
+    }
+    void* obj = cache.cur_;
+    cache.cur_ += bytes;
+    return obj;
+  }
+
+  std::size_t BumpArena::reserved_bytes() const {
+    std::scoped_lock<std::mutex> lock(shared_->lock_);
+    std::size_t total = 0;
+    for (const auto& slab : shared_->slabs_) {
+      total += slab.size();
+    }
+    return total;
+  }
+
+} // namespace lazy
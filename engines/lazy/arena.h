@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lazy {
+
+  // Anonymous, zero-filled memory mappings. With huge_pages the mapping is
+  // first attempted with explicit huge pages (MAP_HUGETLB), falling back to
+  // regular pages with transparent huge pages requested through madvise
+  // if none are reserved on the machine.
+  class Region {
+    public:
+      Region() = default;
+      Region(std::size_t bytes, bool huge_pages);
+      Region(const Region& other) = delete;
+      Region(Region&& other);
+      Region& operator=(Region&& other);
+      ~Region();
+
+      void* data() const;
+      std::size_t size() const;
+
+    private:
+      void release();
+
+      void* data_ = nullptr;
+      std::size_t size_ = 0;
+  };
+
+  // Slab allocator for fixed size objects (the overflow chunks of the
+  // version store).
+  //
+  // Every thread bump-allocates from its own slab, so allocation does not
+  // synchronize except when a thread needs a fresh slab. Objects can be
+  // handed back with deallocate(), in which case they go onto a free list
+  // of the calling thread and are reused by its next allocations. When a
+  // thread exits (or its cache is taken over by another arena), the unused
+  // end of its slab and its free list go back to the arena, for the next
+  // thread which needs a slab. Slabs are only ever returned to the OS all
+  // at once, when the arena is destroyed; the objects in it are not
+  // destructed.
+  class SlabArena {
+    public:
+      static constexpr std::size_t SLAB_BYTES = 2 << 20;
+      static constexpr int FREE_BATCH = 64;
+
+      SlabArena(std::size_t object_size, bool huge_pages);
+      SlabArena(const SlabArena& other) = delete;
+      SlabArena(SlabArena&& other) = delete;
+      ~SlabArena();
+
+      // Zero-filled memory for one object
+      void* allocate();
+      void deallocate(void* obj);
+
+      // Bytes obtained from the OS so far
+      std::size_t reserved_bytes() const;
+
+    private:
+      struct Shared;
+      struct ThreadCache;
+      ThreadCache& local();
+
+      std::size_t object_size_;
+      bool huge_pages_;
+      // Also held by the thread caches, which can outlive the arena
+      std::shared_ptr<Shared> shared_;
+  };
+
+  // Bump allocator for objects of any size, which are all released at once
+  // (the requests of an epoch, see RequestPool).
+  //
+  // Like SlabArena, every thread bump-allocates from its own slab, whose
+  // unused end goes back to the arena when the thread exits. Nothing can be
+  // handed back, slabs are returned to the OS when the arena is destroyed,
+  // and the objects in it are not destructed.
+  class BumpArena {
+    public:
+      static constexpr std::size_t SLAB_BYTES = 2 << 20;
+      // Allocations larger than this get a mapping of their own
+      static constexpr std::size_t MAX_SMALL = SLAB_BYTES / 8;
+      static constexpr std::size_t ALIGN = 8;
+
+      BumpArena(bool huge_pages);
+      BumpArena(const BumpArena& other) = delete;
+      BumpArena(BumpArena&& other) = delete;
+      ~BumpArena();
+
+      // Zero-filled memory, aligned to ALIGN
+      void* allocate(std::size_t bytes);
+
+      // Bytes obtained from the OS so far
+      std::size_t reserved_bytes() const;
+
+    private:
+      struct Shared;
+      struct ThreadCache;
+      ThreadCache& local();
+
+      bool huge_pages_;
+      // See SlabArena::shared_
+      std::shared_ptr<Shared> shared_;
+  };
+
+} // namespace lazy
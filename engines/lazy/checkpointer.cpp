@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "checkpointer.h"
+#include "column_file.h"
+#include "lazy_engine.h"
+#include "linked_table.h"
+
+namespace lazy {
+
+  Checkpointer::Checkpointer(LinkedTable* table, CommandLog* log, std::string path, std::chrono::milliseconds interval)
+    : table_(table), log_(log), path_(std::move(path)), interval_(interval), frontier_(constants::T0 + 1),
+      checkpoints_(0), bytes_(0), truncated_segments_(0), epoch_(constants::T0), stop_(false) {
+    const auto& schema = table_->schema();
+    if (schema.size() != 1 || schema[0].type_ != ColumnType::INT32) {
+      throw std::invalid_argument("Only tables with a single INT32 column can be checkpointed");
+    }
+  }
+
+  Checkpointer::~Checkpointer() {
+    stop();
+  }
+
+  Time Checkpointer::consistent_epoch() {
+    Time last = std::min(log_->durable(), Globals::txs_.last_time());
+    while (frontier_ <= last) {
+      // Holes left by epoch leases have nothing to stickify
+      if (Globals::txs_.at(frontier_) && !Globals::tx_state_.stickified(frontier_)) {
+        break;
+      }
+      frontier_++;
+    }
+    return frontier_ - 1;
+  }
+
+  bool Checkpointer::checkpoint() {
+    // Keeps the version gc where it is while the epoch is picked, so that
+    // the scan can still pin it. The log can lag behind substantiation, so
+    // the gc may be past it already, in which case it is left to a later
+    // checkpoint
+    std::optional<Reclaimer::Pin> hold;
+    while (!hold) {
+      try {
+        hold.emplace(Globals::reclaimer_, Globals::reclaimer_.low_watermark());
+      } catch (const std::runtime_error&) {
+        // The gc moved on between the two
+      }
+    }
+    Time t = consistent_epoch();
+    if (t <= epoch_.load() || t < Globals::reclaimer_.low_watermark()) {
+      return false;
+    }
+    int rows = table_->rows();
+    ColumnFile::Writer out(path_, rows, t);
+    std::vector<int> block(std::min(BLOCK, rows));
+    for (int i = 0; i < rows; i += BLOCK) {
+      int end = std::min(rows, i + BLOCK);
+      table_->scan<int32_t>(0, t, i, end, block.data());
+      out.append(block.data(), end - i);
+    }
+    out.finish();
+
+    // Only now that the checkpoint is on disk
+    truncated_segments_.fetch_add(log_->truncate(t));
+    bytes_.fetch_add(sizeof(ColumnFile::Header) + static_cast<long>(rows) * sizeof(int));
+    epoch_.store(t);
+    checkpoints_.fetch_add(1);
+    return true;
+  }
+
+  void Checkpointer::start() {
+    stop_ = false;
+    thread_ = std::thread(&Checkpointer::run, this);
+  }
+
+  void Checkpointer::stop() {
+    {
+      std::scoped_lock<std::mutex> lock(lock_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void Checkpointer::run() {
+    std::unique_lock<std::mutex> lock(lock_);
+    while (!stop_) {
+      wake_.wait_for(lock, interval_, [this] { return stop_; });
+      if (stop_) {
+        break;
+      }
+      lock.unlock();
+      checkpoint();
+      lock.lock();
+    }
+  }
+
+  Checkpointer::Stats Checkpointer::stats() const {
+    return Stats{checkpoints_.load(), bytes_.load(), truncated_segments_.load(), epoch_.load()};
+  }
+
+} // namespace lazy
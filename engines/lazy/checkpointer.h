@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "command_log.h"
+#include "types.h"
+
+namespace lazy {
+
+  class LinkedTable;
+
+  // Background writer of checkpoints of the (single INT32 column) table.
+  //
+  // A checkpoint is the value of every slot as of one epoch, in a ColumnFile
+  // whose epoch() is that epoch, so that recovery maps it as the base of the
+  // table and only has to replay the commands after it. The epoch is the
+  // newest one such that
+  // - every command up to it is durable in the log
+  // - every transaction up to it is stickified, so that the version store
+  //   has all of their stickies
+  // The slots are read like a snapshot scan (LinkedTable::scan), block by
+  // block: stickification and client reads go on meanwhile, and the
+  // transactions the checkpoint sees are substantiated on the way if nobody
+  // did yet. Once the file is in place, the log segments it covers are
+  // truncated.
+  class Checkpointer {
+    public:
+      // Slots read and written at once
+      static constexpr int BLOCK = 1 << 16;
+
+      struct Stats {
+        long checkpoints_;
+        long bytes_;
+        long truncated_segments_;
+        // Epoch of the newest checkpoint
+        Time epoch_;
+      };
+
+      Checkpointer(LinkedTable* table, CommandLog* log, std::string path, std::chrono::milliseconds interval);
+      Checkpointer(const Checkpointer& other) = delete;
+      ~Checkpointer();
+
+      // Writes a checkpoint on the calling thread, unless nothing was
+      // committed since the previous one. Returns whether one was written.
+      // Must only be called by one thread at a time
+      bool checkpoint();
+      void start();
+      void stop();
+      Stats stats() const;
+
+    private:
+      Time consistent_epoch();
+      void run();
+
+      LinkedTable* table_;
+      CommandLog* log_;
+      std::string path_;
+      std::chrono::milliseconds interval_;
+      // Oldest transaction not known to be stickified
+      Time frontier_;
+
+      std::atomic<long> checkpoints_;
+      std::atomic<long> bytes_;
+      std::atomic<long> truncated_segments_;
+      std::atomic<Time> epoch_;
+
+      std::mutex lock_;
+      std::condition_variable wake_;
+      bool stop_;
+      std::thread thread_;
+  };
+
+} // namespace lazy
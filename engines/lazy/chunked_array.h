@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace lazy {
+
+  // Array indexed by a dense, growing key (Tids, epochs), made of fixed size
+  // chunks which are installed on first use. Growing never moves elements, so
+  // an element can be accessed without synchronizing with accesses to other
+  // elements, and without any lock.
+  template<typename T, int CHUNK_BITS = 14, int MAX_CHUNKS = (1 << 16)>
+  class ChunkedArray {
+    public:
+      static constexpr int CHUNK = 1 << CHUNK_BITS;
+
+      ChunkedArray(): chunks_(new std::atomic<T*>[MAX_CHUNKS]()) {}
+      ChunkedArray(const ChunkedArray& other) = delete;
+      // Frees the chunks this array held
+      ChunkedArray& operator=(ChunkedArray&& other) {
+        if (this != &other) {
+          release();
+          chunks_ = std::move(other.chunks_);
+        }
+        return *this;
+      }
+      ChunkedArray(ChunkedArray&& other) = default;
+
+      // Installs the chunk holding idx if needed. Elements start out
+      // value-initialized
+      T& at(int idx) {
+        int c = idx >> CHUNK_BITS;
+        if (c >= MAX_CHUNKS) {
+          throw std::out_of_range("ChunkedArray index too large");
+        }
+        T* chunk = chunks_[c].load(std::memory_order_acquire);
+        if (chunk == nullptr) {
+          T* fresh = new T[CHUNK]();
+          if (chunks_[c].compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel)) {
+            chunk = fresh;
+          } else {
+            delete[] fresh;
+          }
+        }
+        return chunk[idx & (CHUNK - 1)];
+      }
+
+      // nullptr if the chunk holding idx was never installed
+      T* find(int idx) const {
+        int c = idx >> CHUNK_BITS;
+        if (idx < 0 || c >= MAX_CHUNKS) {
+          return nullptr;
+        }
+        T* chunk = chunks_[c].load(std::memory_order_acquire);
+        return chunk ? &chunk[idx & (CHUNK - 1)] : nullptr;
+      }
+
+      ~ChunkedArray() {
+        release();
+      }
+
+    private:
+      void release() {
+        if (!chunks_) {
+          return;
+        }
+        for (int c = 0; c < MAX_CHUNKS; c++) {
+          delete[] chunks_[c].load();
+        }
+      }
+
+      std::unique_ptr<std::atomic<T*>[]> chunks_;
+  };
+
+} // namespace lazy
@@ -0,0 +1,57 @@
+#include <algorithm>
+
+#include "column.h"
+
+namespace lazy {
+
+  CellColumn::CellColumn(ColumnSpec spec): spec_(spec), chunks_(new std::atomic<char*>[MAX_CHUNKS]()) {
+    if (spec_.width_ <= 0) {
+      throw std::invalid_argument("Columns must have a positive width");
+    }
+  }
+
+  char* CellColumn::cell(int vid) {
+    int c = vid >> CHUNK_BITS;
+    if (vid < 0 || c >= MAX_CHUNKS) {
+      throw std::out_of_range("Row version id too large");
+    }
+    char* chunk = chunks_[c].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      char* fresh = new char[CHUNK * spec_.width_]();
+      if (chunks_[c].compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel)) {
+        chunk = fresh;
+      } else {
+        delete[] fresh;
+      }
+    }
+    return chunk + (vid & (CHUNK - 1)) * spec_.width_;
+  }
+
+  std::string_view CellColumn::get_string(int vid) {
+    assert(spec_.type_ == ColumnType::FIXED_STRING);
+    const char* c = cell(vid);
+    return std::string_view(c, strnlen(c, spec_.width_));
+  }
+
+  void CellColumn::set_string(int vid, std::string_view s) {
+    assert(spec_.type_ == ColumnType::FIXED_STRING);
+    char* c = cell(vid);
+    std::size_t n = std::min<std::size_t>(s.size(), spec_.width_);
+    std::memcpy(c, s.data(), n);
+    std::memset(c + n, 0, spec_.width_ - n);
+  }
+
+  void CellColumn::copy(int from_vid, int to_vid) {
+    std::memcpy(cell(to_vid), cell(from_vid), spec_.width_);
+  }
+
+  CellColumn::~CellColumn() {
+    if (!chunks_) {
+      return;
+    }
+    for (int c = 0; c < MAX_CHUNKS; c++) {
+      delete[] chunks_[c].load();
+    }
+  }
+
+} // namespace lazy
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace lazy {
+
+  enum class ColumnType {
+    INT32, INT64, DOUBLE, FIXED_STRING
+  };
+
+  struct ColumnSpec {
+    ColumnType type_;
+    // Bytes per cell, only chosen for FIXED_STRING
+    int width_;
+
+    static ColumnSpec int32() { return ColumnSpec{ColumnType::INT32, sizeof(int32_t)}; }
+    static ColumnSpec int64() { return ColumnSpec{ColumnType::INT64, sizeof(int64_t)}; }
+    static ColumnSpec float64() { return ColumnSpec{ColumnType::DOUBLE, sizeof(double)}; }
+    // Shorter strings are padded with zeroes, longer ones are truncated
+    static ColumnSpec fixed_string(int width) { return ColumnSpec{ColumnType::FIXED_STRING, width}; }
+  };
+
+  using Schema = std::vector<ColumnSpec>;
+
+  template<typename T>
+  constexpr ColumnType column_type_of() {
+    static_assert(std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t> || std::is_same_v<T, double>,
+                  "Cells are int32_t, int64_t, double or fixed-width strings");
+    if constexpr (std::is_same_v<T, int32_t>) {
+      return ColumnType::INT32;
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+      return ColumnType::INT64;
+    } else {
+      return ColumnType::DOUBLE;
+    }
+  }
+
+  // The cells of one column, for every row version of the table, stored
+  // contiguously (one array per column). Row versions are identified by a
+  // dense version id, handed out by the table.
+  //
+  // Like ChunkedArray, made of chunks which are installed on first use and
+  // never move, so cells can be accessed without any lock. A cell is written
+  // before its row version is published, and only read afterwards, until
+  // the version is collected and its id handed out again.
+  class CellColumn {
+    public:
+      static constexpr int CHUNK_BITS = 12;
+      static constexpr int CHUNK = 1 << CHUNK_BITS;
+      static constexpr int MAX_CHUNKS = 1 << 16;
+
+      CellColumn(ColumnSpec spec);
+      CellColumn(CellColumn&& other) = default;
+      CellColumn(const CellColumn& other) = delete;
+      ~CellColumn();
+
+      ColumnSpec spec() const { return spec_; }
+
+      // Installs the chunk holding vid if needed. Cells start out zeroed
+      char* cell(int vid);
+
+      template<typename T>
+      T get(int vid) {
+        assert(spec_.type_ == column_type_of<T>());
+        T val;
+        std::memcpy(&val, cell(vid), sizeof(T));
+        return val;
+      }
+
+      template<typename T>
+      void set(int vid, T val) {
+        assert(spec_.type_ == column_type_of<T>());
+        std::memcpy(cell(vid), &val, sizeof(T));
+      }
+
+      // Without the zero padding
+      std::string_view get_string(int vid);
+      void set_string(int vid, std::string_view s);
+
+      void copy(int from_vid, int to_vid);
+
+    private:
+      ColumnSpec spec_;
+      std::unique_ptr<std::atomic<char*>[]> chunks_;
+  };
+
+} // namespace lazy
@@ -0,0 +1,153 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "column_file.h"
+#include "directory.h"
+
+namespace lazy {
+
+  namespace {
+    std::runtime_error file_error(const std::string& what, const std::string& path) {
+      return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+    }
+  }
+
+  ColumnFile::ColumnFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw file_error("Cannot open column file", path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw file_error("Cannot stat column file", path);
+    }
+    std::size_t bytes = st.st_size;
+    if (bytes < sizeof(Header)) {
+      close(fd);
+      throw std::runtime_error("Truncated column file " + path);
+    }
+    // Private, so that nothing can ever write through to the file
+    void* p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      throw file_error("Cannot map column file", path);
+    }
+    data_ = p;
+    size_ = bytes;
+
+    const auto* header = static_cast<const Header*>(data_);
+    if (header->magic_ != MAGIC) {
+      release();
+      throw std::runtime_error("Not a column file " + path);
+    }
+    if (header->rows_ > (size_ - sizeof(Header)) / sizeof(int)) {
+      release();
+      throw std::runtime_error("Truncated column file " + path);
+    }
+  }
+
+  ColumnFile::ColumnFile(ColumnFile&& other): data_(other.data_), size_(other.size_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+
+  ColumnFile& ColumnFile::operator=(ColumnFile&& other) {
+    if (this != &other) {
+      release();
+      data_ = other.data_;
+      size_ = other.size_;
+      other.data_ = nullptr;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+
+  // Written next to path and renamed over it, so that a crash never
+  // leaves a half-written column behind, and a column which is mapped
+  // keeps its cells
+  ColumnFile::Writer::Writer(const std::string& path, int rows, Time epoch)
+    : path_(path), tmp_(path + ".tmp"), rows_(rows), written_(0), ok_(true) {
+    f_ = std::fopen(tmp_.c_str(), "wb");
+    if (f_ == nullptr) {
+      throw file_error("Cannot create column file", tmp_);
+    }
+    Header header{};
+    header.magic_ = MAGIC;
+    header.rows_ = rows;
+    header.epoch_ = epoch;
+    ok_ = std::fwrite(&header, sizeof(header), 1, f_) == 1;
+  }
+
+  ColumnFile::Writer::~Writer() {
+    if (f_) {
+      std::fclose(f_);
+      std::remove(tmp_.c_str());
+    }
+  }
+
+  void ColumnFile::Writer::append(const int* cells, int n) {
+    ok_ = ok_ && std::fwrite(cells, sizeof(int), n, f_) == static_cast<std::size_t>(n);
+    written_ += n;
+  }
+
+  void ColumnFile::Writer::finish() {
+    if (written_ != rows_) {
+      throw std::runtime_error("Column file " + path_ + " is missing rows");
+    }
+    bool ok = ok_ && std::fflush(f_) == 0;
+    ok = fsync(fileno(f_)) == 0 && ok;
+    ok = std::fclose(f_) == 0 && ok;
+    f_ = nullptr;
+    if (!ok || std::rename(tmp_.c_str(), path_.c_str()) != 0) {
+      std::remove(tmp_.c_str());
+      throw file_error("Cannot write column file", path_);
+    }
+    // The rename only survives a crash once the directory is synced, and
+    // the checkpointer truncates the log right after this
+    sync_parent_directory(path_);
+  }
+
+  void ColumnFile::write(const std::string& path, const int* cells, int rows, Time epoch) {
+    Writer w(path, rows, epoch);
+    w.append(cells, rows);
+    w.finish();
+  }
+
+  bool ColumnFile::exists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+  }
+
+  const int* ColumnFile::cells() const {
+    return reinterpret_cast<const int*>(static_cast<const char*>(data_) + sizeof(Header));
+  }
+
+  int ColumnFile::rows() const {
+    return data_ ? static_cast<const Header*>(data_)->rows_ : 0;
+  }
+
+  Time ColumnFile::epoch() const {
+    return data_ ? static_cast<const Header*>(data_)->epoch_ : constants::T0;
+  }
+
+  void ColumnFile::release() {
+    if (data_) {
+      munmap(data_, size_);
+      data_ = nullptr;
+      size_ = 0;
+    }
+  }
+
+  ColumnFile::~ColumnFile() {
+    release();
+  }
+
+} // namespace lazy
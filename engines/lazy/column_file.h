@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "types.h"
+
+namespace lazy {
+
+  // On-disk INT32 column: a Header followed by one cell per row. The file is
+  // mapped read-only and the cells are used in place as the base
+  // (constants::T0) version of every slot, so opening a table does not read
+  // or copy it; pages are faulted in by the first reads of their slots.
+  //
+  // The same format holds checkpoints (see Checkpointer): the cells are then
+  // the values of the slots as of epoch().
+  class ColumnFile {
+    public:
+      static constexpr uint64_t MAGIC = 0x4c415a59434f4c31; // "LAZYCOL1"
+
+      struct Header {
+        uint64_t magic_;
+        uint64_t rows_;
+        // Every transaction up to this epoch is reflected in the cells
+        Time epoch_;
+        // Keeps the cells 64-byte aligned in the mapping
+        uint64_t reserved_[5];
+      };
+
+      // Writes a column file rows cells at a time, so that it never needs
+      // to be in memory as a whole. The file only appears at path once
+      // finish() returns (durably, file and directory entry both), until
+      // then it is written next to it
+      class Writer {
+        public:
+          Writer(const std::string& path, int rows, Time epoch);
+          Writer(const Writer& other) = delete;
+          // Drops the file if finish() was not called
+          ~Writer();
+
+          void append(const int* cells, int n);
+          // Throws std::runtime_error unless exactly rows cells were appended
+          void finish();
+
+        private:
+          std::string path_;
+          std::string tmp_;
+          std::FILE* f_;
+          int rows_;
+          int written_;
+          bool ok_;
+      };
+
+      static_assert(sizeof(Header) == 64, "The cells should start on a cache line");
+
+      ColumnFile() = default;
+      // Throws std::runtime_error if path is not a column file
+      ColumnFile(const std::string& path);
+      ColumnFile(const ColumnFile& other) = delete;
+      ColumnFile(ColumnFile&& other);
+      ColumnFile& operator=(ColumnFile&& other);
+      ~ColumnFile();
+
+      // Writes rows cells to path, replacing it
+      static void write(const std::string& path, const int* cells, int rows, Time epoch = constants::T0);
+      static bool exists(const std::string& path);
+
+      const int* cells() const;
+      int rows() const;
+      Time epoch() const;
+
+    private:
+      void release();
+
+      void* data_ = nullptr;
+      std::size_t size_ = 0;
+  };
+
+} // namespace lazy
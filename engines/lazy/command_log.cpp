@@ -0,0 +1,337 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#include "command_log.h"
+#include "directory.h"
+
+namespace lazy {
+
+  namespace {
+    template<typename T>
+    void put(std::vector<char>& out, const T* data, std::size_t n) {
+      const char* bytes = reinterpret_cast<const char*>(data);
+      out.insert(out.end(), bytes, bytes + n * sizeof(T));
+    }
+  }
+
+  CommandLog::CommandLog(const std::string& path, const TxTypes& types)
+    : path_(path), fd_(-1), segment_bytes_(0), types_(types), pending_first_(constants::T0),
+      pending_epoch_(constants::T0), segments_(segments(path)), durable_(constants::T0), stop_(false),
+      records_(0), groups_(0), bytes_(0), truncated_segments_(0) {
+    thread_ = std::thread(&CommandLog::run, this);
+  }
+
+  std::vector<CommandLog::Segment> CommandLog::segments(const std::string& path) {
+    namespace fs = std::filesystem;
+    fs::path prefix(path);
+    fs::path dir = prefix.has_parent_path() ? prefix.parent_path() : fs::path(".");
+    std::string stem = prefix.filename().string() + ".";
+    std::vector<Segment> found;
+    if (!fs::is_directory(dir)) {
+      return found;
+    }
+    for (const auto& entry : fs::directory_iterator(dir)) {
+      std::string name = entry.path().filename().string();
+      if (name.size() <= stem.size() || name.compare(0, stem.size(), stem) != 0) {
+        continue;
+      }
+      std::string suffix = name.substr(stem.size());
+      if (suffix.find_first_not_of("0123456789") != std::string::npos) {
+        continue;
+      }
+      found.push_back(Segment{static_cast<Time>(std::stoll(suffix)), entry.path().string()});
+    }
+    std::sort(found.begin(), found.end(), [](const Segment& a, const Segment& b) { return a.first_ < b.first_; });
+    return found;
+  }
+
+  CommandLog::~CommandLog() {
+    close();
+  }
+
+  uint32_t CommandLog::checksum(const char* data, std::size_t n) {
+    uint32_t h = 2166136261u;
+    for (std::size_t i = 0; i < n; i++) {
+      h = (h ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return h;
+  }
+
+  void CommandLog::encode(const Request* req, std::vector<char>& out) const {
+    auto ops = req->operations();
+    auto slots = req->slots();
+    // The read/write sets of the other requests follow from their shape
+    // or program
+    bool sets = req->rw_known_in_advance();
+    auto writes = sets ? req->write_set() : Span<const int>();
+    auto reads = sets ? req->read_set() : Span<const int>();
+
+    Header h{};
+    h.bytes_ = sizeof(Header) + ops.size() * sizeof(Operation)
+      + (slots.size() + writes.size() + reads.size()) * sizeof(int);
+    h.epoch_ = req->time();
+    h.type_ = types_.id_of(req);
+    h.is_tx_ = req->is_tx();
+    h.n_ops_ = ops.size();
+    h.n_slots_ = slots.size();
+    h.n_writes_ = writes.size();
+    h.n_reads_ = reads.size();
+
+    std::size_t start = out.size();
+    put(out, &h, 1);
+    for (const auto& op : ops) {
+      Operation made = op.as_made();
+      put(out, &made, 1);
+    }
+    put(out, slots.begin(), slots.size());
+    put(out, writes.begin(), writes.size());
+    put(out, reads.begin(), reads.size());
+    uint32_t sum = checksum(out.data() + start + offsetof(Header, epoch_), h.bytes_ - offsetof(Header, epoch_));
+    std::memcpy(out.data() + start + offsetof(Header, checksum_), &sum, sizeof(sum));
+  }
+
+  Request* CommandLog::decode(const Header& h, const char* payload, const TxTypes& types, RequestPool& pool) {
+    const auto* type = types.find(h.type_);
+    if (type == nullptr) {
+      throw std::runtime_error("Command of unknown transaction type " + std::to_string(h.type_));
+    }
+    // The payload is only 4-byte aligned in the log
+    std::vector<Operation> ops(h.n_ops_);
+    std::vector<int> ints(h.n_slots_ + h.n_writes_ + h.n_reads_);
+    std::memcpy(ops.data(), payload, ops.size() * sizeof(Operation));
+    std::memcpy(ints.data(), payload + ops.size() * sizeof(Operation), ints.size() * sizeof(int));
+    Span<const int> slots(ints.data(), h.n_slots_);
+    Span<const int> writes(ints.data() + h.n_slots_, h.n_writes_);
+    Span<const int> reads(ints.data() + h.n_slots_ + h.n_writes_, h.n_reads_);
+
+    if (type->shape_) {
+      return Request::make(pool, h.is_tx_, type->shape_, slots, h.epoch_);
+    }
+    if (h.n_writes_ == 0 && h.n_reads_ == 0) {
+      return Request::make(pool, h.is_tx_, type->code_, ops, h.epoch_);
+    }
+    return Request::make(pool, h.is_tx_, type->code_, ops, writes, reads, h.epoch_);
+  }
+
+  std::vector<Request*> CommandLog::read(const std::string& path, const TxTypes& types, RequestPool& pool,
+                                         Time after, int* torn) {
+    std::vector<Request*> reqs;
+    int torn_segments = 0;
+    std::vector<char> data;
+    auto all = segments(path);
+    for (const auto& segment : all) {
+      FILE* f = std::fopen(segment.path_.c_str(), "rb");
+      if (f == nullptr) {
+        throw std::runtime_error("Cannot open command log segment " + segment.path_ + ": " + std::strerror(errno));
+      }
+      std::fseek(f, 0, SEEK_END);
+      data.resize(std::ftell(f));
+      std::fseek(f, 0, SEEK_SET);
+      std::size_t n = std::fread(data.data(), 1, data.size(), f);
+      std::fclose(f);
+      data.resize(n);
+
+      std::size_t at = 0;
+      while (at < data.size()) {
+        Header h;
+        if (data.size() - at < sizeof(Header)) {
+          break;
+        }
+        std::memcpy(&h, data.data() + at, sizeof(Header));
+        if (h.bytes_ < sizeof(Header) || h.bytes_ > data.size() - at
+            || h.n_ops_ < 0 || h.n_slots_ < 0 || h.n_writes_ < 0 || h.n_reads_ < 0
+            || h.bytes_ != sizeof(Header) + h.n_ops_ * sizeof(Operation)
+                           + (std::size_t(h.n_slots_) + h.n_writes_ + h.n_reads_) * sizeof(int)
+            || checksum(data.data() + at + offsetof(Header, epoch_), h.bytes_ - offsetof(Header, epoch_)) != h.checksum_) {
+          break;
+        }
+        if (h.epoch_ > after) {
+          // A record which passed its checksum but cannot be made into a
+          // request (e.g. slots out of the table) is just as corrupt
+          try {
+            reqs.push_back(decode(h, data.data() + at + sizeof(Header), types, pool));
+          } catch (const std::invalid_argument& e) {
+            throw std::runtime_error("Command log segment " + segment.path_ + " is corrupt at byte "
+                                     + std::to_string(at) + ": " + e.what());
+          }
+        }
+        at += h.bytes_;
+      }
+      if (at < data.size()) {
+        // Only the last group written before a crash may be cut short,
+        // and groups are synced one at a time: anywhere else, the log is
+        // corrupt
+        if (&segment != &all.back()) {
+          throw std::runtime_error("Command log segment " + segment.path_ + " is corrupt at byte "
+                                   + std::to_string(at));
+        }
+        // Cut off, so that it stays the only torn tail once newer
+        // segments are written after it
+        int fd = open(segment.path_.c_str(), O_WRONLY);
+        bool ok = fd >= 0 && ftruncate(fd, at) == 0 && fsync(fd) == 0;
+        int err = errno;
+        if (fd >= 0) {
+          ::close(fd);
+        }
+        if (!ok) {
+          throw std::runtime_error("Cannot cut off the torn tail of " + segment.path_ + ": " + std::strerror(err));
+        }
+        torn_segments++;
+      }
+    }
+    if (torn) {
+      *torn = torn_segments;
+    }
+    return reqs;
+  }
+
+  void CommandLog::append(Request* const* begin, Request* const* end) {
+    if (begin == end) {
+      return;
+    }
+    // Encoded before taking the lock, the flusher only ever waits for a copy
+    thread_local std::vector<char> buf;
+    buf.clear();
+    for (auto* it = begin; it != end; it++) {
+      encode(*it, buf);
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      flushed_.wait(lock, [this] { return pending_.size() < MAX_PENDING; });
+      if (pending_.empty()) {
+        pending_first_ = (*begin)->time();
+      }
+      pending_.insert(pending_.end(), buf.begin(), buf.end());
+      pending_epoch_ = end[-1]->time();
+    }
+    records_.fetch_add(end - begin, std::memory_order_relaxed);
+    appended_.notify_one();
+  }
+
+  Time CommandLog::durable() const {
+    return durable_.load(std::memory_order_acquire);
+  }
+
+  void CommandLog::wait_durable(Time t) {
+    std::unique_lock<std::mutex> lock(lock_);
+    flushed_.wait(lock, [this, t] { return durable() >= t; });
+  }
+
+  int CommandLog::truncate(Time t) {
+    std::scoped_lock<std::mutex> lock(lock_);
+    // A segment ends right before the next one starts. The newest one is
+    // never deleted, it may still be written to
+    std::size_t dead = 0;
+    while (dead + 1 < segments_.size() && segments_[dead + 1].first_ <= t + 1) {
+      std::remove(segments_[dead].path_.c_str());
+      dead++;
+    }
+    if (dead > 0) {
+      sync_parent_directory(path_);
+    }
+    segments_.erase(segments_.begin(), segments_.begin() + dead);
+    truncated_segments_.fetch_add(dead, std::memory_order_relaxed);
+    return dead;
+  }
+
+  void CommandLog::close() {
+    {
+      std::scoped_lock<std::mutex> lock(lock_);
+      stop_ = true;
+    }
+    appended_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  void CommandLog::run() {
+    std::vector<char> group;
+    while (true) {
+      Time first;
+      Time epoch;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        appended_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+        if (pending_.empty()) {
+          return;
+        }
+        // Appends go on into the other buffer while this group is written
+        group.swap(pending_);
+        first = pending_first_;
+        epoch = pending_epoch_;
+      }
+      flushed_.notify_all();
+
+      if (fd_ < 0 || segment_bytes_ >= SEGMENT_BYTES) {
+        roll(first);
+      }
+      write_all(group);
+      segment_bytes_ += group.size();
+      if (fdatasync(fd_) != 0) {
+        throw std::runtime_error(std::string("Cannot sync command log: ") + std::strerror(errno));
+      }
+      bytes_.fetch_add(group.size(), std::memory_order_relaxed);
+      groups_.fetch_add(1, std::memory_order_relaxed);
+      group.clear();
+
+      {
+        std::scoped_lock<std::mutex> lock(lock_);
+        durable_.store(epoch, std::memory_order_release);
+      }
+      flushed_.notify_all();
+    }
+  }
+
+  void CommandLog::roll(Time first) {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    // Zero-padded, so that segments also sort by name
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%020lld", static_cast<long long>(first));
+    std::string path = path_ + suffix;
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+      throw std::runtime_error("Cannot create command log segment " + path + ": " + std::strerror(errno));
+    }
+    // Commands of the segment are only durable once the segment is found
+    sync_parent_directory(path);
+    segment_bytes_ = 0;
+    std::scoped_lock<std::mutex> lock(lock_);
+    segments_.push_back(Segment{first, path});
+  }
+
+  void CommandLog::write_all(const std::vector<char>& group) {
+    std::size_t done = 0;
+    while (done < group.size()) {
+      ssize_t n = write(fd_, group.data() + done, group.size() - done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::runtime_error(std::string("Cannot write command log: ") + std::strerror(errno));
+      }
+      done += n;
+    }
+  }
+
+  CommandLog::Stats CommandLog::stats() const {
+    return Stats{records_.load(), groups_.load(), bytes_.load(), truncated_segments_.load(), durable()};
+  }
+
+} // namespace lazy
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "request.h"
+#include "tx_types.h"
+#include "types.h"
+
+namespace lazy {
+
+  // Write-ahead log of commands.
+  //
+  // Once a request is stickified its epoch and inputs are fixed, and
+  // re-running it on the same state yields the same writes, so the log only
+  // holds what a request was made from (its transaction type, slot
+  // parameters, program or read/write sets) and its epoch, never the values
+  // it writes. Commands are appended by the stickification layer in time
+  // order, before their requests are stickified; committing a request
+  // therefore costs one append to a buffer and does not depend on its
+  // substantiation.
+  //
+  // Group commit: a background thread takes everything appended since its
+  // previous flush and writes it with a single write/fdatasync, while the
+  // appends go on filling the next group. Acknowledgements are pipelined:
+  // appending never waits for the disk (unless MAX_PENDING bytes are
+  // already waiting), callers which need to know that a command is durable
+  // ask for it with wait_durable.
+  //
+  // The log is a sequence of segment files, path.<epoch of their first
+  // command>, a new one being started by the first group past SEGMENT_BYTES.
+  // Once a checkpoint covers every command of a segment, truncate() deletes
+  // it.
+  //
+  // A failing write or sync is fatal: the flusher throws, which terminates
+  // the process instead of acknowledging commands which are not on disk.
+  class CommandLog {
+    public:
+      static constexpr std::size_t MAX_PENDING = 16 << 20;
+      static constexpr std::size_t SEGMENT_BYTES = 4 << 20;
+
+      // Every record starts with a Header, and is followed by n_ops_
+      // Operations, then n_slots_ slot parameters, n_writes_ written slots
+      // and n_reads_ read slots (ints)
+      struct Header {
+        // Of the whole record
+        uint32_t bytes_;
+        // FNV-1a of the record past this field
+        uint32_t checksum_;
+        Time epoch_;
+        int32_t type_;
+        int32_t is_tx_;
+        int32_t n_ops_;
+        int32_t n_slots_;
+        int32_t n_writes_;
+        int32_t n_reads_;
+      };
+
+      struct Segment {
+        // Epoch of its first command
+        Time first_;
+        std::string path_;
+      };
+
+      struct Stats {
+        long records_;
+        long groups_;
+        long bytes_;
+        long truncated_segments_;
+        // Every command up to this epoch is on disk
+        Time durable_;
+      };
+
+      // Appends to the log at path (in new segments), whose commands must
+      // all be older than the ones appended
+      CommandLog(const std::string& path, const TxTypes& types);
+      CommandLog(const CommandLog& other) = delete;
+      // Flushes whatever is still pending
+      ~CommandLog();
+
+      // Logs the commands of the requests, which must be in time order, and
+      // newer than everything logged before. Their epochs must be set
+      void append(Request* const* begin, Request* const* end);
+      // Every command up to this epoch is on disk
+      Time durable() const;
+      void wait_durable(Time t);
+      // Deletes the segments which only hold commands at or before t.
+      // Returns how many were deleted
+      int truncate(Time t);
+      // Flushes whatever is pending and stops the flusher
+      void close();
+      Stats stats() const;
+
+      // The segments of the log at path, oldest first
+      static std::vector<Segment> segments(const std::string& path);
+      // Makes the requests of the commands logged at path after epoch after
+      // again, at their epochs, in time order, from pool. The last segment
+      // is read up to its first record which is cut short or fails its
+      // checksum: the rest of it was never acknowledged, and is cut off the
+      // file. Whether there was such a tail (0 or 1) is stored in torn, if
+      // given. Throws std::runtime_error for commands of unknown types or
+      // which Request::make rejects, and for such a record in any other
+      // segment
+      static std::vector<Request*> read(const std::string& path, const TxTypes& types, RequestPool& pool,
+                                        Time after, int* torn = nullptr);
+      static uint32_t checksum(const char* data, std::size_t n);
+
+    private:
+      void encode(const Request* req, std::vector<char>& out) const;
+      static Request* decode(const Header& h, const char* payload, const TxTypes& types, RequestPool& pool);
+      void run();
+      // Starts the segment of the group whose first command is at first
+      void roll(Time first);
+      void write_all(const std::vector<char>& group);
+
+      std::string path_;
+      // Segment being written, only touched by the flusher
+      int fd_;
+      std::size_t segment_bytes_;
+      const TxTypes& types_;
+
+      std::mutex lock_;
+      // Signalled on appends, and on flushes (for appenders held back by
+      // MAX_PENDING)
+      std::condition_variable appended_;
+      std::condition_variable flushed_;
+      std::vector<char> pending_;
+      // Epochs of the oldest and newest commands in pending_
+      Time pending_first_;
+      Time pending_epoch_;
+      std::vector<Segment> segments_;
+      std::atomic<Time> durable_;
+      bool stop_;
+
+      std::atomic<long> records_;
+      std::atomic<long> groups_;
+      std::atomic<long> bytes_;
+      std::atomic<long> truncated_segments_;
+
+      std::thread thread_;
+  };
+
+} // namespace lazy
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace lazy {
+
+  // Waiting on a 32-bit atomic word changing, without a mutex: a short spin
+  // for waits which end quickly, then parking in the kernel (futex on Linux,
+  // yielding elsewhere).
+  namespace completion {
+
+    static constexpr int SPINS = 128;
+
+    inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+    }
+
+    // Blocks while word == expected. May return spuriously
+    inline void park(std::atomic<uint32_t>& word, uint32_t expected) {
+#ifdef __linux__
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+      (void) word;
+      (void) expected;
+      std::this_thread::yield();
+#endif
+    }
+
+    inline void wake_all(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#else
+      (void) word;
+#endif
+    }
+
+  } // namespace completion
+
+} // namespace lazy
@@ -1,6 +1,3 @@
-#include <mutex>
-
-
 #include "dependency.h"
 #include "request.h"
 #include "logs.h"
@@ -12,9 +9,47 @@ bool LastWrite::was_written() const {
   return tx_ != LastWrite::NO_TX;
 }
 
+void EdgeList::push(Request* dep) {
+  int idx = n_.fetch_add(1, std::memory_order_relaxed);
+  if (idx < INLINE) {
+    inline_[idx] = dep;
+    return;
+  }
+  std::atomic<Chunk*>* link = &overflow_;
+  for (idx -= INLINE; ; idx -= Chunk::CAPACITY) {
+    Chunk* c = link->load(std::memory_order_acquire);
+    if (c == nullptr) {
+      auto* fresh = new Chunk();
+      if (link->compare_exchange_strong(c, fresh, std::memory_order_acq_rel)) {
+        c = fresh;
+      } else {
+        delete fresh;
+      }
+    }
+    if (idx < Chunk::CAPACITY) {
+      c->edges_[idx] = dep;
+      return;
+    }
+    link = &c->next_;
+  }
+}
+
+int EdgeList::size() const {
+  return n_.load(std::memory_order_acquire);
+}
+
+EdgeList::~EdgeList() {
+  Chunk* c = overflow_.load();
+  while (c) {
+    Chunk* next = c->next_.load();
+    delete c;
+    c = next;
+  }
+}
+
 void DependencyGraph::add_txs(const std::vector<Request*>& txs) {
   for (auto* req : txs) {
-    txs_[req->tx_id()] = req;
+    txs_.at(req->tx_id()).store(req, std::memory_order_release);
   }
 }
 
@@ -26,71 +61,36 @@ Time DependencyGraph::time_of_last_write_to(int slot) {
   return tx_of(writer)->time();
 }
 
-std::vector<Request*> DependencyGraph::get_dependencies(Tid of) {
-  std::shared_lock<std::shared_mutex> read(global_lock_ /* lock now*/);
-  auto deps = dependencies_.find(of);
-  if (deps == dependencies_.end()) {
-    return {};
-  }
-  return deps->second;
+const EdgeList& DependencyGraph::get_dependencies(Tid of) {
+  return dependencies_.at(of);
 }
 
 Request* DependencyGraph::tx_of(Tid tid) {
-  return txs_[tid];
+  return txs_.at(tid).load(std::memory_order_acquire);
 }
 
-void DependencyGraph::check_dependencies(Tid tx, const std::vector<int> &read_set) {
-  constexpr bool demo = true;
+Tid DependencyGraph::last_writer_of(int slot) const {
+  return last_writes_[slot].tx_;
+}
 
+void DependencyGraph::add_dependencies(Tid tx, const std::vector<Request*>& deps) {
   // A transaction T1 depends on another, T2, if
   // T1 reads slot "x" and T2 is the last tx to 
   // have written a sticky to the given slot "x".
-  std::shared_lock<std::shared_mutex> read(global_lock_ /* lock now*/);
-  std::unique_lock<std::shared_mutex> write(global_lock_, std::defer_lock_t());
-  bool has_dep = false;
-
-
-  auto add_dep_on_read = [this, &tx, &has_dep, &read, &write](int read_slot) {
-    // FIXME: This actually introduces faux Read-After-Write tx dependency if the 
-    // read is performed in reality on a previous blind write of the same tx
-    const auto& prev = last_writes_[read_slot];
-    if (prev.tx_ != LastWrite::NO_TX && prev.tx_ != tx) {
-      if (!has_dep) {
-        // SUG: use upgradable locks from boost?
-        // SUG: Store deps in array and insert them all at once
-        // to avoid holding the write lock while traversing the whole set
-        read.unlock();
-        write.lock();
-      }
-      has_dep = true;
-      dependencies_[tx].push_back(tx_of(prev.tx_));
-    }
-  };
-
-  // Is it possible for another tx to modify the last write we are stickifying the slot?
-  // No, since the last write is the last tx which has the given record in its write set,
-  // so it's handled by the stickification thread,w hich means it's never the case 
-  // that this can happen while we are here, since this is the same thread
-  if (demo) {
-    // When a tx tries to read a value, it must read it from the time of the
-    // tx which last wrote to it, at the time of stickification.
-    // This ensures that the reads which are performed at substantiation time
-    // are the correct ones
-    // Our hardcoded tx always reads a value and writes to it after. 
-    // After reading each value we then need to assert that we are the last writers
-    // (in case we read the same value again)
-    
-    auto* req = tx_of(tx);
-    
-    add_dep_on_read(req->write1_);
-    add_dep_on_read(req->write2_);
-    add_dep_on_read(req->write3_);
+  // The edges are resolved by the stickification threads (Request::stickify)
+  // and appended to the dense edge list of the transaction.
+  if (deps.empty()) {
+    return;
   }
+  auto& edges = dependencies_.at(tx);
+  for (auto* dep : deps) {
+    edges.push(dep);
+  }
+}
 
-  if (has_dep) {
-    write.unlock(); 
-  } else {
-    read.unlock();
+void DependencyGraph::add_dependencies(const std::vector<std::pair<Tid, Request*>>& edges) {
+  for (const auto& [tx, dep] : edges) {
+    dependencies_.at(tx).push(dep);
   }
 }
 
@@ -1,11 +1,11 @@
 #pragma once
 
-#include <unordered_map>
+#include <atomic>
 #include <vector>
-#include <mutex>
-#include <shared_mutex>
+#include <utility>
 
 // #include "request.h"
+#include "chunked_array.h"
 #include "types.h"
 
 namespace lazy {
@@ -21,6 +21,45 @@ struct LastWrite {
   bool was_written() const;
 };
 
+// Append-only list of the transactions one transaction depends on. The first
+// INLINE edges live in the list itself, the rest in chunks linked in
+// insertion order. Appends are lock-free (several stickification partitions
+// may add edges of the same transaction), and edges are read without any
+// synchronization once the transaction is stickified, since all the
+// appends happen before that is published.
+struct alignas(64) EdgeList {
+  static constexpr int INLINE = 5;
+
+  struct Chunk {
+    static constexpr int CAPACITY = 14;
+    Request* edges_[CAPACITY];
+    std::atomic<Chunk*> next_;
+  };
+
+  std::atomic<int> n_;
+  Request* inline_[INLINE];
+  std::atomic<Chunk*> overflow_;
+
+  void push(Request* dep);
+  int size() const;
+
+  template<typename Fn>
+  void for_each(Fn&& fn) const {
+    int n = size();
+    for (int i = 0; i < n && i < INLINE; i++) {
+      fn(inline_[i]);
+    }
+    int i = INLINE;
+    for (Chunk* c = overflow_.load(std::memory_order_acquire); c != nullptr && i < n; c = c->next_.load(std::memory_order_acquire)) {
+      for (int j = 0; j < Chunk::CAPACITY && i < n; j++, i++) {
+        fn(c->edges_[j]);
+      }
+    }
+  }
+
+  ~EdgeList();
+};
+
 class DependencyGraph {
   public:
     DependencyGraph(int n_slots) {
@@ -29,20 +68,25 @@ class DependencyGraph {
       last_writes_ = std::vector<LastWrite>(n_slots);
     }
     void add_txs(const std::vector<Request*>& txs);
-    /* Must be called without holding the lock. Will acquire a shared lock
-     * and upgrade to exclusive in  case there is indeed a dependency */
-    void check_dependencies(Tid tx, const std::vector<int>& read_set);
-    std::vector<Request*> get_dependencies(Tid of);
+    /* Lock-free, may be called concurrently for the same transaction */
+    void add_dependencies(Tid tx, const std::vector<Request*>& deps);
+    /* Edges of several transactions (dependant, dependency) */
+    void add_dependencies(const std::vector<std::pair<Tid, Request*>>& edges);
+    /* Zero-copy view of the edges, only complete once `of` is stickified */
+    const EdgeList& get_dependencies(Tid of);
     Request* tx_of(Tid tid);
     Time time_of_last_write_to(int slot);
+    // LastWrite::NO_TX if no sticky was written to the slot yet
+    Tid last_writer_of(int slot) const;
 
     void sticky_written(Tid tx, int slot);
 
-    mutable std::shared_mutex global_lock_;
-    std::unordered_map<Tid, std::vector<Request*>> dependencies_;
-    std::unordered_map<Tid, Request*> txs_;
-    std::vector<Request*> requests_;
   private:
+    // Both indexed by Tid, which are dense
+    ChunkedArray<EdgeList> dependencies_;
+    ChunkedArray<std::atomic<Request*>> txs_;
+    // Each slot is only ever touched by the stickification thread which
+    // owns it (see StickificationLayer), so no synchronization is needed
     std::vector<LastWrite> last_writes_;
 };
 
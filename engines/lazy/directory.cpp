@@ -0,0 +1,28 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "directory.h"
+
+namespace lazy {
+
+  void sync_parent_directory(const std::string& path) {
+    std::filesystem::path p(path);
+    std::string dir = p.has_parent_path() ? p.parent_path().string() : std::string(".");
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+      throw std::runtime_error("Cannot open directory " + dir + ": " + std::strerror(errno));
+    }
+    bool ok = fsync(fd) == 0;
+    int err = errno;
+    ::close(fd);
+    if (!ok) {
+      throw std::runtime_error("Cannot sync directory " + dir + ": " + std::strerror(err));
+    }
+  }
+
+} // namespace lazy
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+namespace lazy {
+
+  // Syncs the directory holding path, so that creating, renaming or
+  // removing path survives a crash (fsync of the file itself only covers
+  // its contents). Throws std::runtime_error
+  void sync_parent_directory(const std::string& path);
+
+} // namespace lazy
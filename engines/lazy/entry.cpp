@@ -12,20 +12,20 @@ using std::atomic;
 
 Entry::Entry(Time t, int val): detail_(EntryData(t, val)) {}
 
-int Entry::get_value(std::memory_order ord) {
+int Entry::get_value(std::memory_order ord) const {
   auto detail = detail_.load(ord);
   return detail.val_;
 }
 
-Tid Entry::get_transaction_id(std::memory_order ord) {
+Tid Entry::get_transaction_id(std::memory_order ord) const {
   return static_cast<Tid>(get_value(ord));
 }
 
-Time Entry::sticky_time(std::memory_order ord) {
+Time Entry::sticky_time(std::memory_order ord) const {
   return -1 * write_time(ord);
 }
 
-Time Entry::write_time(std::memory_order ord) {
+Time Entry::write_time(std::memory_order ord) const {
   return detail_.load(ord).t_;
 }
 
@@ -33,7 +33,11 @@ void Entry::write(Time t, int val, std::memory_order ord) {
   detail_.store(EntryData(t, val), ord);
 }
 
-Entry::EntryData Entry::load(std::memory_order ord) {
+bool Entry::compare_exchange(Entry::EntryData& expected, Entry::EntryData desired, std::memory_order ord) {
+  return detail_.compare_exchange_strong(expected, desired, ord);
+}
+
+Entry::EntryData Entry::load(std::memory_order ord) const {
   return detail_.load(ord);
 }
 
@@ -41,6 +45,10 @@ bool Entry::EntryData::is_invalid() const {
   return t_ == constants::T_INVALID;
 }
 
+bool Entry::EntryData::is_empty() const {
+  return t_ == constants::T_EMPTY;
+}
+
 bool Entry::EntryData::has_time(Time t) const {
   return t_ == t || t_ == -t;
 }
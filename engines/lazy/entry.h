@@ -28,6 +28,7 @@ namespace lazy {
         bool has_time(Time t) const;
         bool is_sticky() const;
         bool is_invalid() const;
+        bool is_empty() const;
       };
 
       Entry() = default;
@@ -36,13 +37,14 @@ namespace lazy {
       Entry(Time t, int val);
 
       static Entry sticky(Time t, int val);
-      Tid get_transaction_id(std::memory_order ord = std::memory_order_seq_cst);
-      int get_value(std::memory_order ord = std::memory_order_seq_cst);
-      Time sticky_time(std::memory_order ord = std::memory_order_seq_cst);
-      Time write_time(std::memory_order ord = std::memory_order_seq_cst);
+      Tid get_transaction_id(std::memory_order ord = std::memory_order_seq_cst) const;
+      int get_value(std::memory_order ord = std::memory_order_seq_cst) const;
+      Time sticky_time(std::memory_order ord = std::memory_order_seq_cst) const;
+      Time write_time(std::memory_order ord = std::memory_order_seq_cst) const;
 
       void write(Time t, int val, std::memory_order ord = std::memory_order_seq_cst);
-      Entry::EntryData load(std::memory_order ord = std::memory_order_seq_cst);
+      bool compare_exchange(Entry::EntryData& expected, Entry::EntryData desired, std::memory_order ord = std::memory_order_seq_cst);
+      Entry::EntryData load(std::memory_order ord = std::memory_order_seq_cst) const;
 
     private:
       std::atomic<EntryData> detail_;
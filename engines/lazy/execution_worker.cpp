@@ -1,32 +1,273 @@
-#include <iostream>
+#include <algorithm>
 
 #include "execution_worker.h"
 
 namespace lazy {
 
+	WorkDeque::WorkDeque(): top_(0), bottom_(0) {
+		buffers_.push_back(std::make_unique<Buffer>(1024));
+		buffer_.store(buffers_.back().get());
+	}
+
+	WorkDeque::Buffer* WorkDeque::grow(Buffer* old, int64_t top, int64_t bottom) {
+		buffers_.push_back(std::make_unique<Buffer>(old->capacity_ * 2));
+		auto* fresh = buffers_.back().get();
+		for (int64_t i = top; i < bottom; i++) {
+			fresh->put(i, old->get(i));
+		}
+		buffer_.store(fresh, std::memory_order_seq_cst);
+		return fresh;
+	}
+
+	void WorkDeque::push(Request* req) {
+		int64_t b = bottom_.load(std::memory_order_relaxed);
+		int64_t t = top_.load(std::memory_order_seq_cst);
+		auto* buf = buffer_.load(std::memory_order_relaxed);
+		if (b - t > buf->capacity_ - 1) {
+			buf = grow(buf, t, b);
+		}
+		buf->put(b, req);
+		bottom_.store(b + 1, std::memory_order_seq_cst);
+	}
+
+	Request* WorkDeque::pop() {
+		int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+		auto* buf = buffer_.load(std::memory_order_relaxed);
+		bottom_.store(b, std::memory_order_seq_cst);
+		int64_t t = top_.load(std::memory_order_seq_cst);
+		if (t > b) {
+			// Empty
+			bottom_.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		Request* req = buf->get(b);
+		if (t == b) {
+			// Last element, race the thieves for it
+			if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				req = nullptr;
+			}
+			bottom_.store(b + 1, std::memory_order_relaxed);
+		}
+		return req;
+	}
+
+	Request* WorkDeque::steal() {
+		int64_t t = top_.load(std::memory_order_seq_cst);
+		int64_t b = bottom_.load(std::memory_order_seq_cst);
+		if (t >= b) {
+			return nullptr;
+		}
+		auto* buf = buffer_.load(std::memory_order_seq_cst);
+		Request* req = buf->get(t);
+		if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return req;
+	}
+
+	bool WorkDeque::empty() const {
+		return top_.load(std::memory_order_seq_cst) >= bottom_.load(std::memory_order_seq_cst);
+	}
+
+	ExecutionWorker::ExecutionWorker(ExecutionPool& pool, int id): pool_(pool), id_(id), has_inbox_(false) {}
+
+	void ExecutionWorker::start() {
+		thread_ = std::thread(&ExecutionWorker::run, this);
+	}
+
+	void ExecutionWorker::join() {
+		if (thread_.joinable()) {
+			thread_.join();
+		}
+	}
+
+	const ExecutionWorker::Counters& ExecutionWorker::counters() const {
+		return counters_;
+	}
+
+	void ExecutionWorker::give(Request* const* reqs, std::size_t n) {
+		std::scoped_lock<std::mutex> lock(inbox_lock_);
+		for (std::size_t i = 0; i < n; i++) {
+			inbox_.push_back(reqs[i]);
+		}
+		has_inbox_.store(true, std::memory_order_seq_cst);
+	}
+
+	bool ExecutionWorker::drain_inbox() {
+		if (!has_inbox_.load(std::memory_order_seq_cst)) {
+			return false;
+		}
+		std::vector<Request*> reqs;
+		{
+			std::scoped_lock<std::mutex> lock(inbox_lock_);
+			reqs.swap(inbox_);
+			has_inbox_.store(false, std::memory_order_seq_cst);
+		}
+		// Pushed in reverse, so that the owner pops them oldest first
+		// and thieves take the newest ones
+		for (auto it = reqs.rbegin(); it != reqs.rend(); it++) {
+			deque_.push(*it);
+		}
+		return !reqs.empty();
+	}
+
+	Request* ExecutionWorker::steal() {
+		int n = pool_.workers_.size();
+		for (int k = 1; k < n; k++) {
+			auto& victim = *pool_.workers_[(id_ + k) % n];
+			counters_.steal_attempts_.fetch_add(1, std::memory_order_relaxed);
+			if (auto* req = victim.deque_.steal()) {
+				counters_.steals_.fetch_add(1, std::memory_order_relaxed);
+				return req;
+			}
+		}
+		return nullptr;
+	}
+
+	Request* ExecutionWorker::next() {
+		if (auto* req = deque_.pop()) {
+			return req;
+		}
+		if (drain_inbox()) {
+			return deque_.pop();
+		}
+		return steal();
+	}
+
+	void ExecutionWorker::execute(Request* req) {
+		// Waits if another thread (maybe a reader, outside of the pool) is
+		// executing it right now: it only counts as done once it is, wait_idle
+		// must not return before its writes are in
+		auto res = req->substantiate();
+		if (res == SubstantiateResult::STALLED) {
+			// Request not stickified yet.
+			// In a real system this should never be the case, since the 
+			// substantiation threads only get requests after they have been stickified
+			// and are ready to be executed.
+			counters_.stalled_.fetch_add(1, std::memory_order_relaxed);
+			stalled_.push_back(req);
+			return;
+		}
+		counters_.substantiated_.fetch_add(1, std::memory_order_relaxed);
+		pool_.done(1);
+	}
+
 	void ExecutionWorker::run() {
-		while (!q_.empty()) {
-			execute();
-		}
-	}
-
-	void ExecutionWorker::execute() {
-		if (!q_.empty()) {
-			auto* head = q_.front();
-			q_.pop_front();
-			auto res = head->substantiate();
-			if (res == SubstantiateResult::STALLED) {
-				// std::cout << "stalled" << std::endl;
-				// Request not stickified yet.
-				// In a real system this should never be the case, since the 
-				// substantiation threads only get requests after they have been stickified
-				// and are ready to be executed.
-				// Just put it in the back of the queue and start again
-				q_.push_back(head);
-			} else {
-				// std::cout << "done" << std::endl;
+		while (true) {
+			if (auto* req = next()) {
+				execute(req);
+				continue;
+			}
+			// Anything submitted from now on bumps the work epoch, so look
+			// for work once more before parking on it
+			uint64_t seen = pool_.work_epoch_.load(std::memory_order_seq_cst);
+			if (auto* req = next()) {
+				execute(req);
+				continue;
+			}
+			counters_.parks_.fetch_add(1, std::memory_order_relaxed);
+			if (!pool_.park(seen, !stalled_.empty())) {
+				return;
 			}
+			for (auto* req : stalled_) {
+				deque_.push(req);
+			}
+			stalled_.clear();
+		}
+	}
+
+	ExecutionPool::ExecutionPool(int n_workers)
+		: next_worker_(0), started_(std::chrono::steady_clock::now()), work_epoch_(0),
+		  sleepers_(0), stopping_(false), pending_(0) {
+		for (int i = 0; i < n_workers; i++) {
+			workers_.push_back(std::make_unique<ExecutionWorker>(*this, i));
+		}
+		for (auto& w : workers_) {
+			w->start();
+		}
+	}
+
+	ExecutionPool::~ExecutionPool() {
+		shutdown();
+	}
+
+	void ExecutionPool::submit(Request* req) {
+		submit(std::vector<Request*>{req});
+	}
+
+	void ExecutionPool::submit(const std::vector<Request*>& reqs) {
+		if (reqs.empty()) {
+			return;
 		}
+		pending_.fetch_add(reqs.size(), std::memory_order_seq_cst);
+		std::size_t n = workers_.size();
+		std::size_t per_worker = (reqs.size() + n - 1) / n;
+		for (std::size_t i = 0; i < reqs.size(); i += per_worker) {
+			auto& w = *workers_[next_worker_.fetch_add(1, std::memory_order_relaxed) % n];
+			w.give(reqs.data() + i, std::min(per_worker, reqs.size() - i));
+		}
+		work_epoch_.fetch_add(1, std::memory_order_seq_cst);
+		if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+			std::scoped_lock<std::mutex> lock(park_lock_);
+			wake_.notify_all();
+		}
+	}
+
+	bool ExecutionPool::park(uint64_t seen, bool has_stalled) {
+		std::unique_lock<std::mutex> lock(park_lock_);
+		sleepers_.fetch_add(1, std::memory_order_seq_cst);
+		auto woken = [this, seen]() {
+			return stopping_.load() || work_epoch_.load(std::memory_order_seq_cst) != seen;
+		};
+		if (has_stalled) {
+			// Stickification may finish without submitting anything new
+			wake_.wait_for(lock, std::chrono::milliseconds(1), woken);
+		} else {
+			wake_.wait(lock, woken);
+		}
+		sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+		return !stopping_.load();
+	}
+
+	void ExecutionPool::done(long n) {
+		if (pending_.fetch_sub(n, std::memory_order_seq_cst) == n) {
+			std::scoped_lock<std::mutex> lock(idle_lock_);
+			idle_.notify_all();
+		}
+	}
+
+	void ExecutionPool::wait_idle() {
+		std::unique_lock<std::mutex> lock(idle_lock_);
+		idle_.wait(lock, [this]() { return pending_.load(std::memory_order_seq_cst) == 0; });
 	}
-	
+
+	void ExecutionPool::shutdown() {
+		{
+			std::scoped_lock<std::mutex> lock(park_lock_);
+			stopping_.store(true);
+			wake_.notify_all();
+		}
+		for (auto& w : workers_) {
+			w->join();
+		}
+	}
+
+	ExecutionPool::Stats ExecutionPool::stats() const {
+		Stats s{0, 0, 0, 0, 0, 0};
+		for (const auto& w : workers_) {
+			const auto& c = w->counters();
+			s.substantiated_ += c.substantiated_.load();
+			s.steals_ += c.steals_.load();
+			s.steal_attempts_ += c.steal_attempts_.load();
+			s.parks_ += c.parks_.load();
+			s.stalled_ += c.stalled_.load();
+		}
+		s.seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_).count();
+		return s;
+	}
+
+	double ExecutionPool::Stats::throughput() const {
+		return seconds_ > 0 ? substantiated_ / seconds_ : 0;
+	}
+
 }
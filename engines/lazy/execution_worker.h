@@ -1,21 +1,153 @@
 #pragma once
 
-#include <deque>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "request.h"
 
 namespace lazy {
+
+	// Chase-Lev work-stealing deque. Only the owning worker pushes and pops
+	// (at the bottom), any other worker may steal (from the top).
+	class WorkDeque {
+		public:
+			WorkDeque();
+			WorkDeque(const WorkDeque& other) = delete;
+
+			void push(Request* req);
+			// nullptr if empty
+			Request* pop();
+			// nullptr if empty or if another thief won the race
+			Request* steal();
+			bool empty() const;
+
+		private:
+			struct Buffer {
+				Buffer(int64_t capacity): capacity_(capacity), cells_(new std::atomic<Request*>[capacity]) {}
+				Request* get(int64_t i) const {
+					return cells_[i & (capacity_ - 1)].load(std::memory_order_acquire);
+				}
+				void put(int64_t i, Request* req) {
+					cells_[i & (capacity_ - 1)].store(req, std::memory_order_release);
+				}
+				int64_t capacity_;
+				std::unique_ptr<std::atomic<Request*>[]> cells_;
+			};
+
+			Buffer* grow(Buffer* old, int64_t top, int64_t bottom);
+
+			std::atomic<int64_t> top_;
+			std::atomic<int64_t> bottom_;
+			std::atomic<Buffer*> buffer_;
+			// Every buffer ever used. Thieves may still be reading an old
+			// buffer after a grow, so they are only freed with the deque
+			std::vector<std::unique_ptr<Buffer>> buffers_;
+	};
+
+	class ExecutionPool;
+
 	class ExecutionWorker {
 		public:
-			ExecutionWorker(const std::vector<Request*>& reqs) {
-				q_ = std::deque<Request*>{reqs.begin(), reqs.end()};
-			}
+			ExecutionWorker(ExecutionPool& pool, int id);
+			ExecutionWorker(const ExecutionWorker& other) = delete;
+
+			void start();
+			void join();
+			// Called by submitters, any thread
+			void give(Request* const* reqs, std::size_t n);
+
+			struct alignas(64) Counters {
+				std::atomic<long> substantiated_{0};
+				std::atomic<long> steals_{0};
+				std::atomic<long> steal_attempts_{0};
+				std::atomic<long> parks_{0};
+				std::atomic<long> stalled_{0};
+			};
+			const Counters& counters() const;
+
+		private:
+			friend class ExecutionPool;
 
 			void run();
-			void execute();
+			void execute(Request* req);
+			Request* next();
+			Request* steal();
+			bool drain_inbox();
+
+			ExecutionPool& pool_;
+			int id_;
+			WorkDeque deque_;
+
+			std::mutex inbox_lock_;
+			std::vector<Request*> inbox_;
+			std::atomic<bool> has_inbox_;
+
+			// Requests which were not stickified yet when we tried them.
+			// Retried after the next submission
+			std::vector<Request*> stalled_;
+			Counters counters_;
+			std::thread thread_;
+	};
+
+	// Pool of substantiation workers, fed with stickified requests.
+	//
+	// Submitted requests are spread over the inboxes of the workers, every
+	// worker moves its inbox into its own deque and substantiates from it,
+	// stealing from the other workers once it runs dry. Idle workers park on
+	// a condition variable until something is submitted. Requests which turn
+	// out not to be stickified yet are put aside and retried once more work
+	// comes in (the stickifier submits as it goes), with a timed park as a
+	// fallback.
+	class ExecutionPool {
+		public:
+			ExecutionPool(int n_workers);
+			ExecutionPool(const ExecutionPool& other) = delete;
+			~ExecutionPool();
+
+			void submit(Request* req);
+			void submit(const std::vector<Request*>& reqs);
+			// Blocks until every submitted request was substantiated
+			void wait_idle();
+			void shutdown();
+
+			struct Stats {
+				long substantiated_;
+				long steals_;
+				long steal_attempts_;
+				long parks_;
+				long stalled_;
+				double seconds_;
+
+				double throughput() const;
+			};
+			Stats stats() const;
+
 		private:
-			std::deque<Request*> q_;
+			friend class ExecutionWorker;
+
+			// Returns false once the pool is shutting down
+			bool park(uint64_t seen, bool has_stalled);
+			void done(long n);
+
+			std::vector<std::unique_ptr<ExecutionWorker>> workers_;
+			std::atomic<unsigned> next_worker_;
+			std::chrono::steady_clock::time_point started_;
+
+			std::atomic<uint64_t> work_epoch_;
+			std::atomic<int> sleepers_;
+			std::atomic<bool> stopping_;
+			std::mutex park_lock_;
+			std::condition_variable wake_;
 
+			std::atomic<long> pending_;
+			std::mutex idle_lock_;
+			std::condition_variable idle_;
 	};
 
 }
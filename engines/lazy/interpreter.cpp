@@ -0,0 +1,79 @@
+#include <cassert>
+
+#include "interpreter.h"
+#include "linked_table.h"
+
+namespace lazy {
+
+  static bool valid_reg(Reg r) {
+    return r >= 0 && r < Interpreter::REGISTERS;
+  }
+
+  bool Interpreter::valid(Span<const Operation> ops) {
+    for (const auto& op : ops) {
+      switch (op.ty_) {
+        case READ:
+          if (!valid_reg(op.op_.read_.dst_)) return false;
+          break;
+        case WRITE:
+          if (!valid_reg(op.op_.write_.src_)) return false;
+          break;
+        case CONSTANT:
+          if (!valid_reg(op.op_.constant_.dst_)) return false;
+          break;
+        case BIN_ADD:
+        case BIN_MUL:
+          if (!valid_reg(op.op_.bin_.dst_) || !valid_reg(op.op_.bin_.lhs_) || !valid_reg(op.op_.bin_.rhs_)) return false;
+          break;
+      }
+    }
+    return true;
+  }
+
+  int Interpreter::run(Request* self, LinkedTable* tb, int, int, int) {
+    auto ops = self->operations();
+    assert(valid(ops));
+    Time t = self->time();
+    auto own_write = [t](const Operation& op) { return op.op_.read_.time_ == t; };
+
+    std::vector<int> slots;
+    std::vector<Time> times;
+    for (const auto& op : ops) {
+      if (op.is_read() && !own_write(op)) {
+        slots.push_back(op.op_.read_.slot_);
+        times.push_back(op.op_.read_.time_);
+      }
+    }
+    std::vector<int> fetched(slots.size());
+    tb->tx_read_many(0, slots.data(), times.data(), slots.size(), fetched.data());
+
+    int regs[REGISTERS] = {};
+    auto tx_call = CallingStatus(self->tx_id());
+    std::size_t next_fetched = 0;
+    int writes = 0;
+    for (const auto& op : ops) {
+      switch (op.ty_) {
+        case READ: {
+          const auto& r = op.op_.read_;
+          regs[r.dst_] = own_write(op) ? tb->safe_read_int(r.slot_, 0, r.time_, tx_call) : fetched[next_fetched++];
+          break;
+        }
+        case WRITE:
+          tb->safe_write_int(op.op_.write_.slot_, 0, regs[op.op_.write_.src_], t);
+          writes++;
+          break;
+        case CONSTANT:
+          regs[op.op_.constant_.dst_] = op.op_.constant_.value_;
+          break;
+        case BIN_ADD:
+          regs[op.op_.bin_.dst_] = regs[op.op_.bin_.lhs_] + regs[op.op_.bin_.rhs_];
+          break;
+        case BIN_MUL:
+          regs[op.op_.bin_.dst_] = regs[op.op_.bin_.lhs_] * regs[op.op_.bin_.rhs_];
+          break;
+      }
+    }
+    return writes;
+  }
+
+} // namespace lazy
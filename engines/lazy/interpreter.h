@@ -0,0 +1,29 @@
+#pragma once
+
+#include "request.h"
+
+namespace lazy {
+
+  class LinkedTable;
+
+  // Runs the Operation program of a request over REGISTERS int registers.
+  //
+  // The slots and read times of a program are fixed once it is stickified,
+  // so every read of a version written by another transaction is fetched
+  // from the table up front, in one LinkedTable::tx_read_many call. Reads of
+  // slots the request wrote itself earlier in the program are done in
+  // program order instead, since their version is only there once the write
+  // before them ran.
+  class Interpreter {
+    public:
+      static constexpr int REGISTERS = 32;
+
+      // Computation running self->operations(). The write slots are unused,
+      // the write set of a program request is derived from its operations
+      static int run(Request* self, LinkedTable* tb, int, int, int);
+
+      // Whether every register the program uses exists
+      static bool valid(Span<const Operation> ops);
+  };
+
+} // namespace lazy
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace lazy {
+
+  // SUM/MIN/MAX/COUNT of a column scan. Integer sums are 64-bit
+  template<typename T>
+  struct Aggregate {
+    using Sum = std::conditional_t<std::is_floating_point_v<T>, double, int64_t>;
+
+    int64_t count_ = 0;
+    Sum sum_ = 0;
+    T min_ = std::numeric_limits<T>::max();
+    T max_ = std::numeric_limits<T>::lowest();
+
+    void merge(const Aggregate& other) {
+      count_ += other.count_;
+      sum_ += other.sum_;
+      min_ = std::min(min_, other.min_);
+      max_ = std::max(max_, other.max_);
+    }
+  };
+
+  // Aggregation kernels over resolved values. Written with GCC vector
+  // extensions, so they compile to whatever SIMD the target has (SSE2 at
+  // least on x86-64, AVX2 with -mavx2) without any intrinsics.
+  namespace kernels {
+
+    static constexpr int VECTOR_BYTES = 32;
+
+    template<typename T>
+    void accumulate(const T* vals, int n, Aggregate<T>& agg) {
+      using Sum = typename Aggregate<T>::Sum;
+      constexpr int LANES = VECTOR_BYTES / sizeof(T);
+      typedef T Vec __attribute__((vector_size(VECTOR_BYTES)));
+      typedef Sum SumVec __attribute__((vector_size(LANES * sizeof(Sum))));
+
+      int i = 0;
+      if (n >= LANES) {
+        Vec mn;
+        Vec mx;
+        __builtin_memcpy(&mn, vals, sizeof(Vec));
+        mx = mn;
+        SumVec sum = {};
+        for (; i + LANES <= n; i += LANES) {
+          Vec v;
+          __builtin_memcpy(&v, vals + i, sizeof(Vec));
+          mn = v < mn ? v : mn;
+          mx = v > mx ? v : mx;
+          // Widened first, so that int32 sums do not overflow
+          sum += __builtin_convertvector(v, SumVec);
+        }
+        for (int l = 0; l < LANES; l++) {
+          agg.sum_ += sum[l];
+          agg.min_ = std::min(agg.min_, mn[l]);
+          agg.max_ = std::max(agg.max_, mx[l]);
+        }
+      }
+      for (; i < n; i++) {
+        agg.sum_ += vals[i];
+        agg.min_ = std::min(agg.min_, vals[i]);
+        agg.max_ = std::max(agg.max_, vals[i]);
+      }
+      agg.count_ += n;
+    }
+
+  } // namespace kernels
+
+} // namespace lazy
@@ -10,10 +10,26 @@ namespace lazy {
   LinkedTable* Globals::table_ = nullptr; // initialized later
   DependencyGraph Globals::dep_ = DependencyGraph(Globals::n_slots);
   TxCollection Globals::txs_ = TxCollection();
+  TxStateTable Globals::tx_state_;
+  Reclaimer Globals::reclaimer_;
 
 
   Time Clock::time() const { return current_time_.load(std::memory_order_seq_cst); }
   Time Clock::advance() { return current_time_.fetch_add(1, std::memory_order_seq_cst) + 1; }
+  Time Clock::lease(int n) { return current_time_.fetch_add(n, std::memory_order_seq_cst) + 1; }
+
+  void Clock::advance_to(Time t) {
+    Time now = current_time_.load(std::memory_order_seq_cst);
+    while (now < t && !current_time_.compare_exchange_weak(now, t, std::memory_order_seq_cst)) {}
+  }
+
+  Time EpochLease::next() {
+    if (next_ == end_) {
+      next_ = clock_.lease(SIZE);
+      end_ = next_ + SIZE;
+    }
+    return next_++;
+  }
 
   void Globals::shutdown() {
     if (Globals::table_) {
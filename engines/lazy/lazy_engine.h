@@ -8,6 +8,8 @@
 #include "types.h"
 #include "tx_collection.h"
 #include "dependency.h"
+#include "reclaim.h"
+#include "tx_state.h"
 
 
 namespace lazy {
@@ -19,12 +21,35 @@ namespace lazy {
       Clock(): current_time_(constants::T0) {}
       Time time() const;
       Time advance();
+      // Reserves n consecutive epochs at once, returns the first one
+      Time lease(int n);
+      // Moves the clock to t, unless it is already past it
+      void advance_to(Time t);
     private:
-      // SUG: Use something which doesn't hammer this variable in a concurrent
-      // context?
       std::atomic<Time> current_time_; 
   };
 
+  // Block of epochs leased from a Clock by one thread, so that admitting a
+  // request does not touch the shared clock more than once every SIZE
+  // requests. Epochs handed out by one lease are increasing, but requests
+  // admitted by different threads interleave out of epoch order, and the
+  // epochs of a lease which were never handed out are left as holes, which
+  // is why requests go through TxCollection::sequence before stickification.
+  // The clock only moves forward, so there is no giving them back: those of
+  // a thread which exits (up to SIZE - 1 of them) just leak, like any other
+  // hole. Requests lease from Globals::clock_ (see Request::make)
+  class EpochLease {
+    public:
+      static constexpr int SIZE = 64;
+
+      EpochLease(Clock& clock): clock_(clock), next_(0), end_(0) {}
+      Time next();
+    private:
+      Clock& clock_;
+      Time next_;
+      Time end_;
+  };
+
   static Clock clock;
 
 
@@ -35,17 +60,31 @@ namespace lazy {
       static LinkedTable* table_;
       static DependencyGraph dep_;
       static TxCollection txs_;
+      static TxStateTable tx_state_;
+      static Reclaimer reclaimer_;
       static void shutdown();
 
       // Details of the experiment
       static constexpr int n_slots = 100000;
       static constexpr int tx_count = 400000;
       static constexpr int subst_cores = 4;
+      static constexpr int sticky_cores = 2;
+      // How the mock transactions are declared: a hand-written Computation,
+      // an Operation program run by the Interpreter or a TxTemplate
+      enum class MockTxs { COMPILED, INTERPRETED, TEMPLATE };
+      static constexpr MockTxs mock_txs = MockTxs::TEMPLATE;
+      // Back the table and its versions with huge pages where available
+      static constexpr bool huge_pages = true;
+      // Column file the base versions of the table are mapped from. Created
+      // (every slot set to 1) if missing or of the wrong size
+      static constexpr const char* table_file = "lazy_table.col";
+      // Command log (see CommandLog)
+      static constexpr const char* log_file = "lazy.wal";
   };
 
   /*
      8/10 cores used. Why 8/10 only though? (perhaps assuming other work is used on the other 2 cores, e.g os, other infrastructure which is running on the machine?)
-     Single-threaded stickification layer
+     Slot-partitioned multi-threaded stickification layer (sticky_cores)
      multi-threaded substantiation layer
      */
 
@@ -1,25 +1,42 @@
 #include "linked_table.h"
 #include "logs.h"
+#include "reclaim.h"
 
+#include <algorithm>
 #include <cassert>
+#include <thread>
 
 namespace lazy {
 
-LinkedIntColumn::LinkedIntColumn(std::vector<int>&& data) {
-  data_ = std::vector<Bucket>();
-  data_.reserve(data.size());
-  for (std::vector<Bucket>::size_type i = 0; i < data.size(); i++) {
-    // Only place where the move ctor should be called
-    // since emplace requires that the type is move-ctible
-    // in case of a reallocation due to a resize
-    data_.emplace_back(Bucket(constants::T0, data[i]));
-  }
+LinkedIntColumn::LinkedIntColumn(int ntuples)
+  : ntuples_(ntuples), occupied_(ntuples), actual_size_(ntuples), base_(nullptr),
+    buckets_(ntuples * sizeof(Bucket), Globals::huge_pages),
+    chunks_(std::make_unique<SlabArena>(sizeof(Bucket::Chunk), Globals::huge_pages)) {
+  data_ = static_cast<Bucket*>(buckets_.data());
+}
+
+LinkedIntColumn::LinkedIntColumn(std::vector<int>&& data): LinkedIntColumn(data.size()) {
+  base_data_ = std::move(data);
+  base_ = base_data_.data();
+}
+
+LinkedIntColumn::LinkedIntColumn(ColumnFile&& base): LinkedIntColumn(base.rows()) {
+  base_file_ = std::move(base);
+  base_ = base_file_.cells();
 }
 
 LinkedIntColumn LinkedIntColumn::from_raw(int ntuples, int* data) {
   return LinkedIntColumn(std::vector<int>(data, data + ntuples));
 }
 
+int LinkedIntColumn::latest_value(int bucket) {
+  auto& b = data_[bucket];
+  if (auto val = b.latest_value_fast()) {
+    return *val;
+  }
+  return b.latest_value().value_or(base_[bucket]);
+}
+
 void LinkedIntColumn::insert_at(int bucket, Time t, int val) {
     // Two txs are ordered wrt to the dependency graph if:
     // One reads the other's write to a slot. I.e the latter's readset
@@ -27,37 +44,117 @@ void LinkedIntColumn::insert_at(int bucket, Time t, int val) {
     // However two txs which perform a blind write to a slot are not ordered
     // with respect to the timestamp ordering, therefore the insertions need to
     // be synchronised.
-    data_[bucket].push(t, val);
+    data_[bucket].push(t, val, *chunks_);
+}
+
+void LinkedIntColumn::insert_many(int bucket, const Entry::EntryData* entries, int n) {
+    data_[bucket].push_many(entries, n, *chunks_);
 }
 
-LinkedTable::LinkedTable(std::vector<LinkedIntColumn>* cols): cols_(cols) {
-    int tb_size = (*cols)[0].size();
+int LinkedIntColumn::collect(int bucket, Time low_watermark, std::vector<int>* payloads) {
+    std::vector<Bucket::Chunk*> dead;
+    data_[bucket].truncate(low_watermark, dead);
+    for (auto* chunk : dead) {
+      if (payloads) {
+        // Dead chunks are full of substantiated versions
+        for (const auto& e : chunk->entries_) {
+          payloads->push_back(e.get_value());
+        }
+      }
+      Globals::reclaimer_.retire(chunk, [](void* arena, void* obj) {
+        static_cast<SlabArena*>(arena)->deallocate(obj);
+      }, chunks_.get());
+    }
+    return dead.size();
+}
+
+LinkedTable::LinkedTable(std::vector<int>&& data)
+  : schema_{ColumnSpec::int32()}, versions_(std::move(data)), next_vid_(0) {
+    track_substantiations();
+}
+
+LinkedTable::LinkedTable(ColumnFile&& base)
+  : schema_{ColumnSpec::int32()}, versions_(std::move(base)), next_vid_(0) {
+    track_substantiations();
+}
+
+// A single INT32 column, stored in the version entries themselves
+static bool narrow_schema(const Schema& schema) {
+    return schema.size() == 1 && schema[0].type_ == ColumnType::INT32;
+}
+
+static std::vector<int> initial_payloads(bool narrow, int rows) {
+    std::vector<int> payloads(rows, 0);
+    if (!narrow) {
+        // The initial version of row i is row version i
+        for (int i = 0; i < rows; i++) {
+            payloads[i] = i;
+        }
+    }
+    return payloads;
+}
+
+LinkedTable::LinkedTable(Schema schema, int rows)
+  : schema_(std::move(schema)), versions_(initial_payloads(narrow_schema(schema_), rows)), next_vid_(rows) {
+    if (schema_.empty()) {
+        throw std::invalid_argument("A table needs at least one column");
+    }
+    if (!narrow()) {
+        for (const auto& spec : schema_) {
+            cells_.emplace_back(spec);
+        }
+    }
+    track_substantiations();
+}
+
+void LinkedTable::track_substantiations() {
+    int tb_size = versions_.size();
     last_substantiations_ = std::vector<std::atomic<Time>>(tb_size);
+    collected_substantiations_ = std::vector<Time>(tb_size, constants::T0);
     for (int i = 0; i < tb_size; i++) {
         last_substantiations_[i].store(constants::T0, std::memory_order_seq_cst);
     }
 }
 
 int LinkedIntColumn::size() const {
-    return data_.size();
+    return ntuples_;
+}
+
+bool LinkedTable::narrow() const {
+    return narrow_schema(schema_);
+}
+
+const Schema& LinkedTable::schema() const {
+    return schema_;
 }
 
-void LinkedTable::insert_at(int col, int bucket, Time t, int val) {
-    (*cols_)[col].insert_at(bucket, t, val);
+void LinkedTable::insert_at(int slot, Time t, int val) {
+    Reclaimer::Guard guard(Globals::reclaimer_);
+    versions_.insert_at(slot, t, val);
+}
+
+void LinkedTable::insert_many(int slot, const Entry::EntryData* entries, int n) {
+    Reclaimer::Guard guard(Globals::reclaimer_);
+    versions_.insert_many(slot, entries, n);
 }
 
 int LinkedTable::safe_read_int(int slot, int col, Time t, CallingStatus call) {
-    // TODO: Add a last_physical_write field to each slot. Highly likely that
-    // a slot will be read right after it's written because of a tx dependency,
-    // so we can shortcut the whole linked list traversal business
+    return safe_read<int32_t>(slot, col, t, call);
+}
+
+std::string_view LinkedTable::safe_read_string(int slot, int col, Time t, CallingStatus call) {
+    return cells_[col].get_string(read_payload(slot, t, call));
+}
 
+int LinkedTable::read_payload(int slot, Time t, CallingStatus call) {
+    // Highly likely that a slot will be read right after it's written because
+    // of a tx dependency, so the last physical write of the slot is tried
+    // first, and the version chain is only walked if that misses
 
     if (t == constants::T0) {
-        // For now we assume the table was created
-        // at time constants::T0 and each slot has value 1, so if we receive
-        // a request for a read at time consants::T0 it means it must be a 1,
-        // and it wasn't performed by any transaction, but it comes from the initialisation
-        return 1;
+        // The version the table was created with, which was not
+        // written by any transaction
+        return versions_.base_value(slot);
     }
 
     // Distinguish between a safe read being called by a client and one being 
@@ -73,28 +170,81 @@ int LinkedTable::safe_read_int(int slot, int col, Time t, CallingStatus call) {
     // no intermetidate state should be leaked to the client.
 
     // cout << "safe read int slot " << slot << " which was written at time " << t << endl;
-    auto& column = (*cols_)[col].data_;
-    auto responsible_tx = Globals::txs_.at(t);
-    auto status = responsible_tx->execution_status();
-    if (status == ExecutionStatus::DONE) {
-        auto e = column[slot].entry_at(t);
-        assert(e.has_value());
-        // cout << "read to " << slot << " at t " << t << " has value " << e->val_ << endl;
-        return e->val_;
+    Reclaimer::Guard guard(Globals::reclaimer_);
+    auto& bucket = versions_.data_[slot];
+    if (Globals::tx_state_.status(t) == ExecutionStatus::DONE) {
+        return read_version(bucket, t);
     };
     if (call.is_client()) {
         // either substantiate (or wait for substantiation to finish) and read the value afterwards
         // cout << " client substantiating txid " <<  responsible_tx->tx_id() << endl;
-        responsible_tx->substantiate();
+        Globals::txs_.at(t)->substantiate();
         // cout << responsible_tx->tx_id() << " done substantiating via client call" << endl;
     } else {
         // cout << "read performed by tx " << call.get_tx() << " with time " << Globals::dep_.tx_of(call.get_tx())->time() << " on slot " << slot << " from time " << t << endl;
     }
     // At this point all the writes that this tx depends on
-    auto e = column[slot].entry_at(t);
+    return read_version(bucket, t);
+}
+
+void LinkedTable::read_many(int col, Span<const SlotRead> reads, int* out) {
+    Reclaimer::Guard guard(Globals::reclaimer_);
+    auto* buckets = versions_.data_;
+    std::vector<Time> pending;
+    for (const auto& r : reads) {
+        __builtin_prefetch(&buckets[r.slot_]);
+        if (r.t_ != constants::T0 && Globals::tx_state_.status(r.t_) != ExecutionStatus::DONE) {
+            pending.push_back(r.t_);
+        }
+    }
+    // Older transactions first: the newer ones often depend on them, and
+    // find them done already
+    std::sort(pending.begin(), pending.end());
+    pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+    for (Time t : pending) {
+        Globals::txs_.at(t)->substantiate();
+    }
+
+    for (int i = 0; i < reads.size(); i++) {
+        int slot = reads[i].slot_;
+        Time t = reads[i].t_;
+        out[i] = t == constants::T0 ? versions_.base_value(slot) : read_version(buckets[slot], t);
+    }
+    if (!narrow()) {
+        for (int i = 0; i < reads.size(); i++) {
+            out[i] = cells_[col].get<int32_t>(out[i]);
+        }
+    }
+}
+
+void LinkedTable::tx_read_many(int col, const int* slots, const Time* ts, int n, int* out) {
+    Reclaimer::Guard guard(Globals::reclaimer_);
+    auto* buckets = versions_.data_;
+    // The slots of one transaction are scattered over the table,
+    // get all of their buckets on the way before reading any of them
+    for (int i = 0; i < n; i++) {
+        __builtin_prefetch(&buckets[slots[i]]);
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = ts[i] == constants::T0 ? versions_.base_value(slots[i]) : read_version(buckets[slots[i]], ts[i]);
+    }
+    if (!narrow()) {
+        for (int i = 0; i < n; i++) {
+            out[i] = cells_[col].get<int32_t>(out[i]);
+        }
+    }
+}
+
+int LinkedTable::read_version(Bucket& bucket, Time t) {
+    if (auto val = bucket.last_write_at(t)) {
+        fast_hits_.add();
+        return *val;
+    }
+    chain_walks_.add();
+    auto e = bucket.entry_at(t);
     assert(e.has_value());
     assert(!e->is_sticky());
-    // cout << "read to " << slot << " at t " << t << " has value " << e->val_ << endl;
+    // cout << "read at t " << t << " has value " << e->val_ << endl;
     return e->val_;
 }
 
@@ -106,28 +256,256 @@ void LinkedTable::safe_write_int(int slot, int col, int val, Time t) {
     // case this does not matter)
     
     // cout << "safe write to slot " << slot << endl;
-    auto& column = (*cols_)[col].data_;
-    auto& bucket = column[slot];
-    bucket.write_at(t, val);
+    if (!narrow() || col != 0) {
+        throw std::logic_error("Only tables with a single INT32 column can be written cell by cell");
+    }
+    publish(slot, t, val);
+}
+
+RowWrite LinkedTable::write_row(int slot, Time t, Time base, CallingStatus call) {
+    int base_payload = read_payload(slot, base, call);
+    if (narrow()) {
+        return RowWrite(this, slot, t, base_payload);
+    }
+    int vid = new_vid();
+    for (auto& col : cells_) {
+        col.copy(base_payload, vid);
+    }
+    return RowWrite(this, slot, t, vid);
+}
+
+int LinkedTable::new_vid() {
+    if (n_free_vids_.load(std::memory_order_relaxed) > 0) {
+        std::scoped_lock<std::mutex> lock(free_vids_lock_);
+        if (!free_vids_.empty()) {
+            int vid = free_vids_.back();
+            free_vids_.pop_back();
+            n_free_vids_.store(free_vids_.size(), std::memory_order_relaxed);
+            return vid;
+        }
+    }
+    return next_vid_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LinkedTable::publish(int slot, Time t, int payload) {
+    Reclaimer::Guard guard(Globals::reclaimer_);
+    versions_.data_[slot].write_at(t, payload);
+}
+
+RowWrite& RowWrite::set_string(int col, std::string_view s) {
+    tb_->cells_[col].set_string(payload_, s);
+    return *this;
+}
+
+void RowWrite::commit() {
+    tb_->publish(slot_, t_, payload_);
 }
 
 int LinkedTable::rows() const {
-    return (*cols_)[0].size();
+    return versions_.size();
 }
 
-int LinkedTable::checksum() {
-    int nrows = rows();
-    auto& col = (*cols_)[0];
-    int sum = 0;
-    for (int i = 0; i < nrows; i++) {
-        int val = col.data_[i].latest_value();
-        sum += val;
+// Transactions are added to Globals::txs_ before they are stickified, and
+// only ever newer than the ones in it: the epochs up to its last time it has
+// no transaction for are holes left by epoch leases for good
+Time LinkedTable::stickified_frontier() {
+    Time last = Globals::txs_.last_time();
+    Time seen = stickified_.load(std::memory_order_acquire);
+    Time t = seen;
+    while (t <= last && (!Globals::txs_.at(t) || Globals::tx_state_.stickified(t))) {
+        t++;
+    }
+    // Concurrent callers may have got further meanwhile
+    while (seen < t && !stickified_.compare_exchange_weak(seen, t, std::memory_order_acq_rel)) {}
+    return t - 1;
+}
+
+int64_t LinkedTable::checksum(int n_threads) {
+    // Not at the clock: stickies of older transactions may still be
+    // inserted, the snapshot would then miss their versions
+    Time now = stickified_frontier();
+    if (n_threads == 1) {
+        return aggregate<int32_t>(0, now).sum_;
+    }
+    return parallel_aggregate<int32_t>(0, now, n_threads).sum_;
+}
+
+template<typename SlotAt>
+void LinkedTable::payloads_as_of(Time t, int n, SlotAt slot_at, int* out) {
+    Reclaimer::Guard guard(Globals::reclaimer_);
+    // Indices whose version is a sticky, with the time of the sticky: the
+    // entry is substantiated in place, so it is not looked up again
+    std::vector<SlotRead> pending;
+    for (int i = 0; i < n; i++) {
+        int slot = slot_at(i);
+        auto& bucket = versions_.data_[slot];
+        if (auto val = bucket.value_as_of_fast(t)) {
+            fast_hits_.add();
+            out[i] = *val;
+            continue;
+        }
+        chain_walks_.add();
+        auto e = bucket.version_as_of(t);
+        if (!e.has_value()) {
+            out[i] = versions_.base_value(slot);
+        } else if (e->is_sticky()) {
+            pending.push_back(SlotRead{i, -e->t_});
+        } else {
+            out[i] = e->val_;
+        }
+    }
+    // Only the versions the snapshot sees are substantiated, like
+    // client reads would
+    for (const auto& p : pending) {
+        // The sticky may be seen before its transaction is published as
+        // stickified, by the last of the partitions it accesses
+        Request* tx;
+        while (!(tx = Globals::txs_.at(p.t_)) || tx->substantiate() == SubstantiateResult::STALLED) {
+            std::this_thread::yield();
+        }
+        out[p.slot_] = read_version(versions_.data_[slot_at(p.slot_)], p.t_);
+    }
+}
+
+void LinkedTable::scan_payloads(Time t, int begin, int end, int* out) {
+    payloads_as_of(t, end - begin, [begin](int i) { return begin + i; }, out);
+}
+
+void LinkedTable::read_as_of(int col, Time t, Span<const int> slots, int* out) {
+    if (schema_.at(col).type_ != ColumnType::INT32) {
+        throw std::invalid_argument("Reading a column as the wrong type");
+    }
+    // Versions at t must not be collected while we are looking at them
+    Reclaimer::Pin pin(Globals::reclaimer_, t);
+    payloads_as_of(t, slots.size(), [&slots](int i) { return slots[i]; }, out);
+    if (!narrow()) {
+        for (int i = 0; i < slots.size(); i++) {
+            out[i] = cells_[col].get<int32_t>(out[i]);
+        }
+    }
+}
+
+template<typename T>
+void LinkedTable::scan_block(int col, Time t, int begin, int end, T* out) {
+    if constexpr (std::is_same_v<T, int32_t>) {
+        if (narrow()) {
+            scan_payloads(t, begin, end, out);
+            return;
+        }
     }
-    return sum;
+    int payloads[SCAN_BLOCK];
+    scan_payloads(t, begin, end, payloads);
+    auto& cells = cells_[col];
+    for (int i = 0; i < end - begin; i++) {
+        out[i] = cells.get<T>(payloads[i]);
+    }
+}
+
+template<typename T>
+void LinkedTable::scan(int col, Time t, int begin, int end, T* out) {
+    if (schema_.at(col).type_ != column_type_of<T>()) {
+        throw std::invalid_argument("Scanning a column as the wrong type");
+    }
+    // Versions at t must not be collected while we are looking at them
+    Reclaimer::Pin pin(Globals::reclaimer_, t);
+    for (int i = begin; i < end; i += SCAN_BLOCK) {
+        scan_block(col, t, i, std::min(end, i + SCAN_BLOCK), out + (i - begin));
+    }
+}
+
+template<typename T>
+Aggregate<T> LinkedTable::aggregate(int col, Time t, int begin, int end) {
+    if (schema_.at(col).type_ != column_type_of<T>()) {
+        throw std::invalid_argument("Scanning a column as the wrong type");
+    }
+    Reclaimer::Pin pin(Globals::reclaimer_, t);
+    Aggregate<T> agg;
+    T vals[SCAN_BLOCK];
+    for (int i = begin; i < end; i += SCAN_BLOCK) {
+        int block_end = std::min(end, i + SCAN_BLOCK);
+        scan_block(col, t, i, block_end, vals);
+        kernels::accumulate(vals, block_end - i, agg);
+    }
+    return agg;
 }
 
+template<typename T>
+Aggregate<T> LinkedTable::parallel_aggregate(int col, Time t, int n_threads) {
+    if (schema_.at(col).type_ != column_type_of<T>()) {
+        throw std::invalid_argument("Scanning a column as the wrong type");
+    }
+    // Held for the whole scan, so the workers can always pin t as well
+    Reclaimer::Pin pin(Globals::reclaimer_, t);
+    int n = rows();
+    std::atomic<int> next_morsel(0);
+    std::vector<Aggregate<T>> partials(n_threads);
+    auto work = [this, col, t, n, &next_morsel, &partials](int id) {
+        Aggregate<T> local;
+        while (true) {
+            int begin = next_morsel.fetch_add(MORSEL, std::memory_order_relaxed);
+            if (begin >= n) {
+                break;
+            }
+            local.merge(aggregate<T>(col, t, begin, std::min(n, begin + MORSEL)));
+        }
+        partials[id] = local;
+    };
 
-void LinkedTable::enforce_wirte_set_substantiation(Time new_time, const std::vector<int>& write_set) {
+    std::vector<std::thread> ts;
+    for (int id = 1; id < n_threads; id++) {
+        ts.emplace_back(work, id);
+    }
+    work(0);
+    for (auto& th : ts) {
+        th.join();
+    }
+    Aggregate<T> agg;
+    for (const auto& partial : partials) {
+        agg.merge(partial);
+    }
+    return agg;
+}
+
+template void LinkedTable::scan<int32_t>(int, Time, int, int, int32_t*);
+template void LinkedTable::scan<int64_t>(int, Time, int, int, int64_t*);
+template void LinkedTable::scan<double>(int, Time, int, int, double*);
+template Aggregate<int32_t> LinkedTable::aggregate<int32_t>(int, Time, int, int);
+template Aggregate<int64_t> LinkedTable::aggregate<int64_t>(int, Time, int, int);
+template Aggregate<double> LinkedTable::aggregate<double>(int, Time, int, int);
+template Aggregate<int32_t> LinkedTable::parallel_aggregate<int32_t>(int, Time, int);
+template Aggregate<int64_t> LinkedTable::parallel_aggregate<int64_t>(int, Time, int);
+template Aggregate<double> LinkedTable::parallel_aggregate<double>(int, Time, int);
+
+LinkedTable::ReadStats LinkedTable::read_stats() const {
+    return ReadStats{fast_hits_.load(), chain_walks_.load()};
+}
+
+int LinkedTable::collect_versions(Time low_watermark) {
+    int nrows = rows();
+    int retired = 0;
+    std::vector<int> dropped;
+    for (int slot = 0; slot < nrows; slot++) {
+        // Nothing was substantiated under the low-watermark in the slot since
+        // we last looked at it, so there is nothing new to collect either
+        Time substantiated = std::min(last_substantiations_[slot].load(std::memory_order_seq_cst), low_watermark);
+        if (substantiated <= collected_substantiations_[slot]) {
+            continue;
+        }
+        collected_substantiations_[slot] = substantiated;
+        retired += versions_.collect(slot, low_watermark, narrow() ? nullptr : &dropped);
+    }
+    if (!dropped.empty()) {
+        // No reader can be handed one of those versions anymore (readers
+        // still traversing the retired chunks only look at their entries),
+        // so their cells can be rewritten right away
+        std::scoped_lock<std::mutex> lock(free_vids_lock_);
+        free_vids_.insert(free_vids_.end(), dropped.begin(), dropped.end());
+        n_free_vids_.store(free_vids_.size(), std::memory_order_relaxed);
+    }
+    return retired;
+}
+
+void LinkedTable::enforce_wirte_set_substantiation(Time new_time, Span<const int> write_set) {
   for (auto slot : write_set) {
     Time before = last_substantiations_[slot].load(std::memory_order_seq_cst);
     Time best_time = std::max(before, new_time);
@@ -137,10 +515,4 @@ void LinkedTable::enforce_wirte_set_substantiation(Time new_time, const std::vec
 
 }
 
-LinkedTable::~LinkedTable() {
-  if (cols_) {
-    delete cols_;
-  }
-}
-
 }
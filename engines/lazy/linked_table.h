@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <mutex>
 #include <stdexcept>
 #include <atomic>
@@ -9,139 +11,332 @@
 #include <list>
 #include <optional>
 #include <cassert>
+#include <memory>
+#include <new>
 
+#include "arena.h"
+#include "column.h"
+#include "column_file.h"
+#include "kernels.h"
 #include "lazy_engine.h"
 #include "logs.h"
 #include "request.h"
+#include "span.h"
+#include "stats.h"
 #include "types.h"
 #include "entry.h"
 
 namespace lazy {
 
-  struct Bucket {
+  // Version store of a single slot.
+  //
+  // The first constants::TIMESTAMPS_PER_TUPLE versions of a slot live inline,
+  // so that a bucket occupies exactly one cache line. Hot slots spill into
+  // fixed size overflow chunks (two cache lines each), which are linked from
+  // the newest to the oldest one, so that reads which look for recent versions
+  // find them in the first chunk they touch.
+  //
+  // The base (constants::T0) version of a slot is not kept in its bucket but
+  // in the column (LinkedIntColumn::base_value), so a bucket only ever holds
+  // versions written by transactions, and stays untouched until the first one.
+  //
+  // Appending is lock-free: a pusher reserves an index with a fetch_add on
+  // reserved_, installs the chunk which holds that index if needed (CAS on
+  // head_) and then publishes the entry in place. Readers never look at
+  // reserved_, they scan every entry reachable from head_ and skip the ones
+  // which were not published yet (time == constants::T_EMPTY).
+  // Buckets are never constructed: a zeroed bucket is a valid, empty bucket.
+  //
+  // Versions are appended in time order (stickification walks the
+  // transactions in time order), and last_write_ caches the newest version
+  // which was substantiated, so that the common case of a read following
+  // the write it depends on does not need to look at the chain at all.
+  struct alignas(64) Bucket {
+    static constexpr int INLINE_VERSIONS = constants::TIMESTAMPS_PER_TUPLE;
 
-    // TODO: Make an iterator interface
-    struct BucketNode {
-      Entry entry_; 
-      std::atomic<BucketNode*> next_;
-      
-      BucketNode(Time t, int val): entry_(t, val), next_(nullptr) {}
+    struct alignas(64) Chunk {
+      static constexpr int CAPACITY = 14;
 
-      ~BucketNode() {
-        auto* next = next_.load();
-        if (next) {
-          delete next;
-        }
-      }
-    };
+      Entry entries_[CAPACITY]{};
+      // Bucket-wide index of entries_[0]
+      int first_;
+      // Next older chunk
+      std::atomic<Chunk*> prev_;
 
-    Bucket(Time t, int val) {
-      auto* node = new BucketNode(t, val);
-      head_ = node;
-      tail_ = node;
-      size_.store(1);
-    }
+      Chunk(int first, Chunk* prev): first_(first), prev_(prev) {}
+    };
 
     Bucket() = delete;
-    Bucket(Bucket&& other) {
-      // TO NEVER BE USED OUTSIDE OF TABLE INITIALIZATION.
-      // in LinkedIntColumn::LinkedIntColumn(std::vector<int>&& data)
-      // Comment in constructor. Otherwise should NEVER be used
-      head_.store(other.head_.load());
-      tail_.store(other.tail_.load());
-      other.head_.store(nullptr);
-      other.tail_.store(nullptr);
-      size_.store(other.size());
-    }
+    Bucket(Bucket&& other) = delete;
     Bucket(const Bucket& other) = delete;
 
-    std::atomic<BucketNode*> head_;
-    std::atomic<BucketNode*> tail_;
-    std::atomic<int> size_;
+    Entry inline_[INLINE_VERSIONS]{};
+    std::atomic<Chunk*> head_;
+    std::atomic<int> reserved_;
+    Entry last_write_{};
 
-    void push(Time t, int val) {
-      auto* node = new BucketNode(t, val);
-      push(node);
-      size_.fetch_add(1);
+    // Overflow chunks are allocated from the arena of the column
+    void push(Time t, int val, SlabArena& chunks) {
+      int idx = reserved_.fetch_add(1, std::memory_order_seq_cst);
+      slot(idx, chunks).write(t, val, std::memory_order_seq_cst);
     }
 
+    // Appends n versions at once, in order, with a single reservation
+    void push_many(const Entry::EntryData* entries, int n, SlabArena& chunks) {
+      int first = reserved_.fetch_add(n, std::memory_order_seq_cst);
+      for (int i = 0; i < n; i++) {
+        slot(first + i, chunks).write(entries[i].t_, entries[i].val_, std::memory_order_seq_cst);
+      }
+    }
+
+    // Number of versions, including the ones which are still being published
     int size() const {
-      return size_.load();
+      return reserved_.load();
     }
 
     std::optional<Entry::EntryData> entry_at(Time t) {
-      Bucket::BucketNode* e = head_.load(std::memory_order_seq_cst);
-      Entry::EntryData entry;
-      while (e != nullptr) {
-          entry = e->entry_.load(std::memory_order_seq_cst);
-          if (entry.has_time(t)) {
-              // cout << "found desired entry at time " << entry.t_ << endl;
-              return {entry};
-          }
-          e = e->next_.load(std::memory_order_seq_cst);
+      std::optional<Entry::EntryData> found;
+      for_each_entry([&](Entry& e) {
+        auto entry = e.load(std::memory_order_seq_cst);
+        if (entry.has_time(t)) {
+          found = entry;
+          return true;
+        }
+        return false;
+      });
+      return found;
+    }
+
+    void write_at(Time t, int val) {
+      bool written = for_each_entry([&](Entry& e) {
+        auto entry = e.load(std::memory_order_seq_cst);
+        if (entry.has_time(t)) {
+          e.write(t, val, std::memory_order_seq_cst);
+          return true;
+        }
+        return false;
+      });
+      if (!written) {
+        throw std::runtime_error("Trying to write to an entry at a time which doesn't exist");
+      }
+      auto last = last_write_.load(std::memory_order_seq_cst);
+      while (last.t_ <= t && !last_write_.compare_exchange(last, Entry::EntryData(t, val))) {}
+    }
+
+    // The value written at t, if that is the newest substantiated version
+    std::optional<int> last_write_at(Time t) {
+      auto last = last_write_.load(std::memory_order_seq_cst);
+      if (last.t_ == t) {
+        return last.val_;
       }
       return std::nullopt;
     }
 
-    void write_at(Time t, int val) {
-      Bucket::BucketNode* e = head_.load(std::memory_order_seq_cst);
-      Entry::EntryData entry;
-      while (e != nullptr) {
-          entry = e->entry_.load(std::memory_order_seq_cst);
-          if (entry.has_time(t)) {
-              e->entry_.write(t, val, std::memory_order_seq_cst);
-              return;
-          }
-          e = e->next_.load(std::memory_order_seq_cst);
+    // latest_value() without a chain walk, if the newest version is the
+    // newest substantiated one
+    std::optional<int> latest_value_fast() {
+      auto last = last_write_.load(std::memory_order_seq_cst);
+      if (last.is_empty()) {
+        return std::nullopt;
       }
-      throw std::runtime_error("Trying to write to an entry at a time which doesn't exist");
+      const Entry* newest = peek(reserved_.load(std::memory_order_seq_cst) - 1);
+      if (newest != nullptr && newest->load(std::memory_order_seq_cst).t_ == last.t_) {
+        return last.val_;
+      }
+      return std::nullopt;
     }
-  
-    int latest_value() {
-      Bucket::BucketNode* e = head_.load(std::memory_order_seq_cst);
-      Entry::EntryData entry;
+
+    // The newest substantiated version, if any
+    std::optional<int> latest_value() {
       Time latest = 0;
-      int val = 1;
-      while (e != nullptr) {
-          entry = e->entry_.load(std::memory_order_seq_cst);
-          if (entry.t_ < 0) {
-            // cout << "entry has t < 0: " << entry.t_ << endl;
+      std::optional<int> val;
+      for_each_entry([&](Entry& e) {
+        auto entry = e.load(std::memory_order_seq_cst);
+        if (entry.is_empty()) {
+          return false;
+        }
+        assert(entry.t_ > 0);
+        if (entry.t_ > latest) {
+          latest = entry.t_;
+          val = entry.val_;
+        }
+        return false;
+      });
+      return val;
+    }
+
+    // The newest version at or before t without a chain walk, if that is
+    // the newest substantiated version and nothing newer was pushed
+    std::optional<int> value_as_of_fast(Time t) {
+      auto last = last_write_.load(std::memory_order_seq_cst);
+      if (last.is_empty() || last.t_ > t) {
+        return std::nullopt;
+      }
+      const Entry* newest = peek(reserved_.load(std::memory_order_seq_cst) - 1);
+      if (newest != nullptr && newest->load(std::memory_order_seq_cst).t_ == last.t_) {
+        return last.val_;
+      }
+      return std::nullopt;
+    }
+
+    // The newest version at or before t, which may be a sticky. None if
+    // that is the base version
+    std::optional<Entry::EntryData> version_as_of(Time t) {
+      std::optional<Entry::EntryData> found;
+      // Entries are visited newest first, so the first one which is old
+      // enough is the one
+      for_each_entry([&](Entry& e) {
+        auto entry = e.load(std::memory_order_seq_cst);
+        if ((entry.is_sticky() ? -entry.t_ : entry.t_) <= t) {
+          found = entry;
+          return true;
+        }
+        return false;
+      });
+      return found;
+    }
+
+    // Unlinks the oldest overflow chunks which only hold substantiated
+    // versions older than the newest substantiated version at or before
+    // low_watermark: no reader can ask for those anymore. The unlinked chunks
+    // are appended to dead, and must only be freed once no reader can still
+    // be traversing them. Must only be called by one thread at a time.
+    void truncate(Time low_watermark, std::vector<Chunk*>& dead) {
+      Time keep = constants::T_EMPTY;
+      for_each_entry([&](Entry& e) {
+        auto entry = e.load(std::memory_order_seq_cst);
+        if (!entry.is_sticky() && entry.t_ <= low_watermark && entry.t_ > keep) {
+          keep = entry.t_;
+        }
+        return false;
+      });
+      Chunk* newer = head_.load(std::memory_order_seq_cst);
+      if (keep == constants::T_EMPTY || newer == nullptr) {
+        return;
+      }
+
+      // The head chunk is never unlinked, pushers may be installing
+      // a chunk on top of it
+      Chunk* cut = nullptr;
+      for (Chunk* c = newer->prev_.load(); c != nullptr; newer = c, c = c->prev_.load()) {
+        bool dead_chunk = true;
+        for (auto& e : c->entries_) {
+          auto entry = e.load(std::memory_order_seq_cst);
+          if (entry.is_empty() || entry.is_sticky() || entry.t_ >= keep) {
+            dead_chunk = false;
+            break;
           }
-          assert(entry.t_ > 0);
-          if (entry.t_ > latest) {
-            latest = entry.t_;
-            val = entry.val_;
+        }
+        if (!dead_chunk) {
+          cut = nullptr;
+        } else if (cut == nullptr) {
+          cut = newer;
+        }
+      }
+      if (cut == nullptr) {
+        return;
+      }
+      Chunk* c = cut->prev_.load();
+      cut->prev_.store(nullptr, std::memory_order_seq_cst);
+      for (; c != nullptr; c = c->prev_.load()) {
+        dead.push_back(c);
+      }
+    }
+
+    // Visits the published entries, newest chunk first, until fn returns true.
+    // Returns whether fn returned true for any entry.
+    template<typename Fn>
+    bool for_each_entry(Fn&& fn) {
+      Chunk* c = head_.load(std::memory_order_seq_cst);
+      while (c != nullptr) {
+        for (int i = Chunk::CAPACITY - 1; i >= 0; i--) {
+          if (!c->entries_[i].load(std::memory_order_seq_cst).is_empty() && fn(c->entries_[i])) {
+            return true;
           }
-          e = e->next_.load(std::memory_order_seq_cst);
+        }
+        c = c->prev_.load(std::memory_order_seq_cst);
       }
-      return val; 
+      for (int i = INLINE_VERSIONS - 1; i >= 0; i--) {
+        if (!inline_[i].load(std::memory_order_seq_cst).is_empty() && fn(inline_[i])) {
+          return true;
+        }
+      }
+      return false;
     }
 
-    void push(BucketNode* e) {
-      auto prev_tail = tail_.load(std::memory_order_seq_cst);
-      while (!tail_.compare_exchange_strong(prev_tail, e, std::memory_order_seq_cst, std::memory_order_seq_cst)) {
-        // Backoff?
-        // Relaxed loads to avoid contention?
-        prev_tail = tail_.load(std::memory_order_seq_cst);
+  private:
+    // The entry with the given bucket-wide index, nullptr if the chunk
+    // holding it was not installed yet
+    const Entry* peek(int idx) {
+      if (idx < INLINE_VERSIONS) {
+        return &inline_[idx];
       }
-      prev_tail->next_.store(e, std::memory_order_seq_cst);
+      for (Chunk* c = head_.load(std::memory_order_seq_cst); c != nullptr; c = c->prev_.load(std::memory_order_seq_cst)) {
+        if (c->first_ <= idx) {
+          return c->first_ + Chunk::CAPACITY > idx ? &c->entries_[idx - c->first_] : nullptr;
+        }
+      }
+      return nullptr;
     }
 
-    ~Bucket() {
-      auto* head = head_.load();
-      if (head) {
-        delete head;
+    // The entry with the given bucket-wide index. Installs the overflow
+    // chunks up to the one holding idx if they do not exist yet.
+    Entry& slot(int idx, SlabArena& chunks) {
+      if (idx < INLINE_VERSIONS) {
+        return inline_[idx];
       }
+      Chunk* head = head_.load(std::memory_order_seq_cst);
+      while (head == nullptr || head->first_ + Chunk::CAPACITY <= idx) {
+        int first = head == nullptr ? INLINE_VERSIONS : head->first_ + Chunk::CAPACITY;
+        auto* fresh = new (chunks.allocate()) Chunk(first, head);
+        if (!head_.compare_exchange_strong(head, fresh, std::memory_order_seq_cst, std::memory_order_seq_cst)) {
+          // Someone else installed the chunk, head now holds it
+          chunks.deallocate(fresh);
+          continue;
+        }
+        head = fresh;
+      }
+      while (head->first_ > idx) {
+        head = head->prev_.load(std::memory_order_seq_cst);
+      }
+      return head->entries_[idx - head->first_];
     }
   };
 
+  static_assert(sizeof(Bucket) == 64, "A bucket should fit in one cache line");
+  static_assert(sizeof(Bucket::Chunk) == 128, "An overflow chunk should fit in two cache lines");
+
+  // The buckets of a column live in one zeroed mapping (on huge pages
+  // if Globals::huge_pages), and their overflow chunks in the column's own
+  // slab arena. Tearing down a column unmaps both at once, nothing
+  // is freed version by version.
+  //
+  // The base versions are either the vector the column was built from or
+  // a mapped ColumnFile, used as they are: building a column does not touch
+  // any bucket, and the pages of a bucket are only faulted in once a version
+  // is pushed to it.
   class LinkedIntColumn {
     public:
       LinkedIntColumn(std::vector<int>&& data);
+      LinkedIntColumn(ColumnFile&& base);
+      LinkedIntColumn(LinkedIntColumn&& other) = default;
+      LinkedIntColumn(const LinkedIntColumn& other) = delete;
       int size() const;
       static LinkedIntColumn from_raw(int ntuples, int* data);
 
+      // The value of bucket at constants::T0
+      int base_value(int bucket) const {
+        return base_[bucket];
+      }
+      // The newest substantiated value of bucket, its base value if none
+      int latest_value(int bucket);
+
       void insert_at(int bucket, Time t, int val);
+      void insert_many(int bucket, const Entry::EntryData* entries, int n);
+      // Truncates the version chain of bucket and retires the unlinked
+      // chunks. The payloads of the dropped versions are appended to
+      // payloads, if given. Returns how many chunks were retired
+      int collect(int bucket, Time low_watermark, std::vector<int>* payloads = nullptr);
 
       // What is the logical capacity of records of this
       int ntuples_;
@@ -152,34 +347,186 @@ namespace lazy {
       // How many slots are occupied (a record with x written-to timestamps occupies x actual size slots)
       int actual_size_; 
       
-      // Worth using manual allocation to avoid default ctor being called everywhere?
-      std::vector<Bucket> data_;
+      Bucket* data_;
+
+    private:
+      LinkedIntColumn(int ntuples);
+
+      // Only one of them holds the base versions
+      std::vector<int> base_data_;
+      ColumnFile base_file_;
+      const int* base_;
+      Region buckets_;
+      std::unique_ptr<SlabArena> chunks_;
   };
 
+  class LinkedTable;
+
+  struct SlotRead {
+    int slot_;
+    Time t_;
+  };
+
+  // The cells of one row version being written. Cells which are not set keep
+  // the value they have in the base version. Nothing is visible until commit()
+  class RowWrite {
+    public:
+      template<typename T>
+      RowWrite& set(int col, T val);
+      RowWrite& set_string(int col, std::string_view s);
+      // Publishes the row version at the time of the write
+      void commit();
+
+    private:
+      friend class LinkedTable;
+      RowWrite(LinkedTable* tb, int slot, Time t, int payload): tb_(tb), slot_(slot), t_(t), payload_(payload) {}
+
+      LinkedTable* tb_;
+      int slot_;
+      Time t_;
+      // Value for narrow tables, row version id otherwise
+      int payload_;
+  };
+
+  // Versioned table of typed columns.
+  //
+  // Versions are kept per row (slot), not per cell: a transaction which writes
+  // several columns of a row publishes them all under the one timestamp, and
+  // stickies and the dependency graph work on rows. The version store
+  // (LinkedIntColumn) maps every row version to an int payload:
+  // - if the schema is a single INT32 column, the payload is the value itself,
+  //   and there is no other storage
+  // - otherwise it is the id of the row version in the CellColumns, which
+  //   keep the cells of every row version column by column
   class LinkedTable {
     public:
-        LinkedTable() = default;
-        LinkedTable(std::vector<LinkedIntColumn>* cols);
+        // A single INT32 column, with the given initial values
+        LinkedTable(std::vector<int>&& data);
+        // A single INT32 column, whose initial values are read from the
+        // mapped file (see ColumnFile)
+        LinkedTable(ColumnFile&& base);
+        // Every cell of every row starts out zeroed
+        LinkedTable(Schema schema, int rows);
+        LinkedTable(const LinkedTable& other) = delete;
         int rows() const;
-        void insert_at(int col, int bucket, Time t, int val);
+        const Schema& schema() const;
+        // Stickies are inserted per row
+        void insert_at(int slot, Time t, int val);
+        // Appends n versions to the slot, in order
+        void insert_many(int slot, const Entry::EntryData* entries, int n);
         
         int safe_read_int(int slot, int col, Time t, CallingStatus call);
+        // Any column, with the same semantics as safe_read_int
+        template<typename T>
+        T safe_read(int slot, int col, Time t, CallingStatus call);
+        std::string_view safe_read_string(int slot, int col, Time t, CallingStatus call);
+        // Client reads of several slots, done together: out[i] is
+        // reads[i].slot_ as of reads[i].t_. Every transaction which wrote one
+        // of the versions and is not substantiated yet is substantiated once,
+        // oldest first, before anything is read
+        void read_many(int col, Span<const SlotRead> reads, int* out);
+        // Client reads of several slots as of t: out[i] is the version of
+        // slots[i] a snapshot scan at t would see. Only for INT32 columns
+        void read_as_of(int col, Time t, Span<const int> slots, int* out);
+        // Reads of a transaction during its execution, done together:
+        // out[i] is slots[i] as of ts[i]. The writers of all of the versions
+        // must already be substantiated
+        void tx_read_many(int col, const int* slots, const Time* ts, int n, int* out);
+        // Only for tables with a single INT32 column, other tables must
+        // write whole rows
         void safe_write_int(int slot, int col, int val, Time t);
+        // Starts writing the version of slot at t, on top of the version at
+        // base, which is read like safe_read_int would (for a transaction,
+        // the version it read, or its own earlier write)
+        RowWrite write_row(int slot, Time t, Time base, CallingStatus call);
 
         // TODO remove
         int size_at(int slot, int col) {
-          return (*cols_)[0].data_[slot].size();
+          return versions_.data_[slot].size();
+        }
+        void enforce_wirte_set_substantiation(Time new_time, Span<const int> write_set);
+
+        // Sum of column 0 (INT32) at the newest versions, as of the newest
+        // time up to which every transaction is stickified
+        int64_t checksum(int n_threads = 1);
+
+        // Snapshot scan: the values of col in the slots [begin, end) as of t,
+        // into out. The versions of transactions at or before t which are
+        // not substantiated yet are substantiated first. T must be the type
+        // of the column. The stickies of every transaction at or before t
+        // must be inserted already, or the snapshot misses their versions
+        template<typename T>
+        void scan(int col, Time t, int begin, int end, T* out);
+        template<typename T>
+        Aggregate<T> aggregate(int col, Time t, int begin, int end);
+        template<typename T>
+        Aggregate<T> aggregate(int col, Time t) {
+          return aggregate<T>(col, t, 0, rows());
         }
-        void safe_write_int(int slot, int col, int val, Time t, Tid as);
-        void enforce_wirte_set_substantiation(Time new_time, const std::vector<int>& write_set);
+        // aggregate() of the whole column, on n_threads threads (the calling
+        // one included). The column is split in MORSEL slots which the
+        // threads take in turn, each substantiating what its morsels need
+        template<typename T>
+        Aggregate<T> parallel_aggregate(int col, Time t, int n_threads);
 
-        int checksum();
+        struct ReadStats {
+          // Reads answered from the last physical write of the slot
+          long fast_hits_;
+          // Reads which had to walk the version chain
+          long chain_walks_;
+        };
+        ReadStats read_stats() const;
+
+        // Drops the versions no reader at or after low_watermark can read,
+        // in the slots which had a version substantiated under the
+        // low-watermark since the previous call. The ids of the dropped row
+        // versions are handed out again by write_row, with their cells.
+        // Must only be called by one thread at a time (the version GC).
+        // Returns how many overflow chunks were retired
+        int collect_versions(Time low_watermark);
 
-      ~LinkedTable();
     private:
-      std::vector<LinkedIntColumn>* cols_;
+      friend class RowWrite;
+
+      bool narrow() const;
+      // Every slot starts out substantiated at constants::T0
+      void track_substantiations();
+      // Payload of the version of slot at t, substantiating it first if
+      // this is a client read
+      int read_payload(int slot, Time t, CallingStatus call);
+      // Payload of the version of bucket at t, which must be substantiated
+      int read_version(Bucket& bucket, Time t);
+      void publish(int slot, Time t, int payload);
+      // Id for a new row version, one of a collected version if any
+      int new_vid();
+      // Newest time up to which every transaction of Globals::txs_ is
+      // stickified
+      Time stickified_frontier();
+      // Slots resolved at once by scan(), so that the payloads and values
+      // of a block stay in cache
+      static constexpr int SCAN_BLOCK = 1024;
+      static constexpr int MORSEL = 16 * SCAN_BLOCK;
+      // Payloads of the slots [begin, end) as of t
+      void scan_payloads(Time t, int begin, int end, int* out);
+      // Payloads of the n slots slot_at(i) as of t
+      template<typename SlotAt>
+      void payloads_as_of(Time t, int n, SlotAt slot_at, int* out);
+      template<typename T>
+      void scan_block(int col, Time t, int begin, int end, T* out);
+
+      Schema schema_;
+      LinkedIntColumn versions_;
+      std::vector<CellColumn> cells_;
+      // Row version ids 0..rows-1 are the initial versions of the rows
+      std::atomic<int> next_vid_;
+      // Ids of the row versions dropped by collect_versions
+      std::mutex free_vids_lock_;
+      std::vector<int> free_vids_;
+      std::atomic<int> n_free_vids_{0};
+      // Oldest transaction not known to be stickified. Only moves forward,
+      // so that checksum does not rescan every epoch from T0
+      std::atomic<Time> stickified_{constants::T0 + 1};
 
-      // SUG: Move this and IntColumn into the same allocation
       // The value in last_substantiations guarantees that the last substantiation
       // has happened at least at a time >= the value.
       // If last_substntiations_[slot] < t, the substantiation may have actually
@@ -190,7 +537,35 @@ namespace lazy {
       //
       // This is a best-effort construct
       std::vector<std::atomic<Time>> last_substantiations_;
-      // TODO free cols
+      // last_substantiations_ of each slot as of the previous collect_versions.
+      // Only touched by the version GC
+      std::vector<Time> collected_substantiations_;
+
+      ShardedCounter fast_hits_;
+      ShardedCounter chain_walks_;
   };
 
+  template<typename T>
+  T LinkedTable::safe_read(int slot, int col, Time t, CallingStatus call) {
+    int payload = read_payload(slot, t, call);
+    if constexpr (std::is_same_v<T, int32_t>) {
+      if (narrow()) {
+        return payload;
+      }
+    }
+    return cells_[col].get<T>(payload);
+  }
+
+  template<typename T>
+  RowWrite& RowWrite::set(int col, T val) {
+    if constexpr (std::is_same_v<T, int32_t>) {
+      if (tb_->narrow()) {
+        payload_ = val;
+        return *this;
+      }
+    }
+    tb_->cells_[col].set<T>(payload_, val);
+    return *this;
+  }
+
 } // namespace lazy
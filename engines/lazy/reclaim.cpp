@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+#include "reclaim.h"
+
+namespace lazy {
+
+  // Releases the slot a thread took in a reclaimer when the thread exits
+  struct SlotOwner {
+    Reclaimer* r_ = nullptr;
+    int idx_ = -1;
+
+    ~SlotOwner() {
+      if (r_) {
+        r_->slots_[idx_].used_.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  Reclaimer::Reclaimer(): global_epoch_(1), low_watermark_(constants::T0) {
+    for (auto& slot : slots_) {
+      slot.epoch_.store(0, std::memory_order_relaxed);
+      slot.pin_.store(constants::T_INVALID, std::memory_order_relaxed);
+      slot.used_.store(false, std::memory_order_relaxed);
+      slot.depth_ = 0;
+    }
+  }
+
+  Reclaimer::ThreadSlot& Reclaimer::local() {
+    // Reclaimers are process-wide singletons (see Globals), so a thread
+    // only ever needs a slot in one of them
+    thread_local SlotOwner owner;
+    if (owner.r_ == this) {
+      return slots_[owner.idx_];
+    }
+    for (int i = 0; i < MAX_THREADS; i++) {
+      bool expected = false;
+      if (!slots_[i].used_.load(std::memory_order_relaxed)
+          && slots_[i].used_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        slots_[i].depth_ = 0;
+        owner.r_ = this;
+        owner.idx_ = i;
+        return slots_[i];
+      }
+    }
+    throw std::runtime_error("Too many threads registered with the reclaimer");
+  }
+
+  Reclaimer::Guard::Guard(Reclaimer& r): r_(r) {
+    auto& slot = r_.local();
+    if (slot.depth_++ == 0) {
+      slot.epoch_.store(r_.global_epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+  }
+
+  Reclaimer::Guard::~Guard() {
+    auto& slot = r_.local();
+    if (--slot.depth_ == 0) {
+      slot.epoch_.store(0, std::memory_order_release);
+    }
+  }
+
+  Reclaimer::Pin::Pin(Reclaimer& r, Time t): r_(r), t_(t) {
+    auto& slot = r_.local();
+    std::scoped_lock<std::mutex> lock(r_.pins_lock_);
+    if (t < r_.low_watermark()) {
+      throw std::runtime_error("Pinning a time older than the version gc low-watermark");
+    }
+    prev_ = slot.pin_.load(std::memory_order_relaxed);
+    slot.pin_.store(std::min(prev_, t), std::memory_order_seq_cst);
+  }
+
+  Reclaimer::Pin::~Pin() {
+    r_.local().pin_.store(prev_, std::memory_order_seq_cst);
+  }
+
+  void Reclaimer::Pin::advance(Time t) {
+    assert(t >= t_);
+    t_ = t;
+    r_.local().pin_.store(std::min(prev_, t), std::memory_order_seq_cst);
+  }
+
+  void Reclaimer::retire(void* obj, Deleter deleter, void* ctx) {
+    uint64_t epoch = global_epoch_.load(std::memory_order_seq_cst);
+    std::scoped_lock<std::mutex> lock(retired_lock_);
+    retired_.push_back(Retired{obj, deleter, ctx, epoch});
+  }
+
+  std::size_t Reclaimer::reclaim() {
+    global_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (const auto& slot : slots_) {
+      uint64_t e = slot.epoch_.load(std::memory_order_seq_cst);
+      if (e != 0) {
+        oldest = std::min(oldest, e);
+      }
+    }
+
+    std::vector<Retired> freeable;
+    {
+      std::scoped_lock<std::mutex> lock(retired_lock_);
+      auto still_reachable = std::partition(retired_.begin(), retired_.end(),
+          [oldest](const Retired& r) { return r.epoch_ >= oldest; });
+      freeable.assign(still_reachable, retired_.end());
+      retired_.erase(still_reachable, retired_.end());
+    }
+    for (const auto& r : freeable) {
+      r.deleter_(r.ctx_, r.obj_);
+    }
+    return freeable.size();
+  }
+
+  Time Reclaimer::oldest_pin() const {
+    Time oldest = constants::T_INVALID;
+    for (const auto& slot : slots_) {
+      oldest = std::min(oldest, slot.pin_.load(std::memory_order_seq_cst));
+    }
+    return oldest;
+  }
+
+  Time Reclaimer::publish_low_watermark(Time candidate) {
+    std::scoped_lock<std::mutex> lock(pins_lock_);
+    Time t = std::min(candidate, oldest_pin());
+    // The low-watermark never moves backwards
+    t = std::max(t, low_watermark());
+    low_watermark_.store(t, std::memory_order_seq_cst);
+    return t;
+  }
+
+  Time Reclaimer::low_watermark() const {
+    return low_watermark_.load(std::memory_order_seq_cst);
+  }
+
+} // namespace lazy
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "types.h"
+
+namespace lazy {
+
+  // Epoch-based reclamation of memory which lock-free readers may still be
+  // traversing after it was unlinked, plus the registry of the times that
+  // readers pinned.
+  //
+  // A thread which reads shared version data does so inside a Guard. Memory
+  // which was unlinked is retire()d with the reclamation epoch of the moment
+  // it was unlinked, and is only handed back to its deleter once every thread
+  // which is inside a Guard has entered it in a later epoch.
+  //
+  // A Pin announces that the pinning thread may read versions at any time
+  // >= the pinned time until the pin is dropped, the version GC never
+  // collects those.
+  class Reclaimer {
+    public:
+      using Deleter = void (*)(void* ctx, void* obj);
+      static constexpr int MAX_THREADS = 256;
+
+      class Guard {
+        public:
+          Guard(Reclaimer& r);
+          Guard(const Guard& other) = delete;
+          ~Guard();
+        private:
+          Reclaimer& r_;
+      };
+
+      class Pin {
+        public:
+          // Throws if versions at time t may have been collected already
+          Pin(Reclaimer& r, Time t);
+          Pin(const Pin& other) = delete;
+          ~Pin();
+          // Moves the pin forward to t, which must not be older than the
+          // pinned time. Never throws: nothing newer than the pin was
+          // collected
+          void advance(Time t);
+        private:
+          Reclaimer& r_;
+          Time t_;
+          Time prev_;
+      };
+
+      Reclaimer();
+
+      void retire(void* obj, Deleter deleter, void* ctx);
+      // Hands the retired objects which no guarded thread can reach anymore
+      // back to their deleters. Returns how many were freed
+      std::size_t reclaim();
+
+      // The oldest time pinned by any thread, constants::T_INVALID if none
+      Time oldest_pin() const;
+      // Publishes min(candidate, oldest pin) as the low-watermark and returns
+      // it. Called by the version GC before it collects anything older than
+      // the returned time. No pin older than it can be taken afterwards
+      Time publish_low_watermark(Time candidate);
+      Time low_watermark() const;
+
+    private:
+      struct alignas(64) ThreadSlot {
+        // Reclamation epoch the thread entered its guard in, 0 if not inside one
+        std::atomic<uint64_t> epoch_;
+        std::atomic<Time> pin_;
+        std::atomic<bool> used_;
+        // Only touched by the owning thread
+        int depth_;
+      };
+
+      struct Retired {
+        void* obj_;
+        Deleter deleter_;
+        void* ctx_;
+        uint64_t epoch_;
+      };
+
+      ThreadSlot& local();
+
+      ThreadSlot slots_[MAX_THREADS];
+      std::atomic<uint64_t> global_epoch_;
+      std::atomic<Time> low_watermark_;
+      // Orders taking pins with publishing the low-watermark
+      std::mutex pins_lock_;
+
+      std::mutex retired_lock_;
+      std::vector<Retired> retired_;
+
+      friend struct SlotOwner;
+  };
+
+} // namespace lazy
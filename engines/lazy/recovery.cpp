@@ -0,0 +1,46 @@
+#include <chrono>
+
+#include "linked_table.h"
+#include "recovery.h"
+#include "stickifier.h"
+#include "tx_collection.h"
+
+namespace lazy {
+
+  namespace {
+    double ms_since(std::chrono::steady_clock::time_point start) {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+  }
+
+  std::vector<Request*> Recovery::recover(ColumnFile&& checkpoint, const std::string& log_path,
+                                          const TxTypes& types, RequestPool& requests,
+                                          ExecutionPool* pool, Stats* stats) {
+    using clk = std::chrono::steady_clock;
+    Time base = checkpoint.epoch();
+    Globals::table_ = new LinkedTable(std::move(checkpoint));
+
+    auto start = clk::now();
+    int torn = 0;
+    auto reqs = CommandLog::read(log_path, types, requests, base, &torn);
+    double read_ms = ms_since(start);
+    Time last = reqs.empty() ? base : reqs.back()->time();
+    // New requests are admitted after everything recovered
+    Globals::clock_.advance_to(last);
+
+    // Versions up to the checkpoint are all in the base of the table:
+    // stickification reads them at constants::T0
+    start = clk::now();
+    Globals::dep_.add_txs(reqs);
+    Globals::txs_ = TxCollection(reqs);
+    // The commands are in the log already, they are not logged again
+    StickificationLayer(Globals::sticky_cores, pool).stickify(reqs);
+    double stickify_ms = ms_since(start);
+
+    if (stats) {
+      *stats = Stats{base, last, static_cast<long>(reqs.size()), torn, read_ms, stickify_ms};
+    }
+    return reqs;
+  }
+
+} // namespace lazy
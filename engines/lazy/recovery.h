@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "column_file.h"
+#include "command_log.h"
+#include "execution_worker.h"
+#include "request.h"
+#include "tx_types.h"
+
+namespace lazy {
+
+  // Lazy restart of the engine from a checkpoint and the command log.
+  //
+  // The checkpoint is mapped as the base of the table (see ColumnFile), and
+  // the commands logged after its epoch are made into requests again, at
+  // their epochs, and stickified, which rebuilds their stickies and the
+  // dependency graph. None of them is executed: like any stickified request,
+  // each is substantiated once a read needs one of its writes, or by pool
+  // if one is given. The engine can take traffic as soon as recover returns,
+  // after the time it takes to stickify the log tail rather than to run it.
+  class Recovery {
+    public:
+      struct Stats {
+        // Epoch of the checkpoint recovered from
+        Time checkpoint_;
+        // Newest epoch recovered
+        Time last_epoch_;
+        long replayed_;
+        int torn_segments_;
+        double read_ms_;
+        double stickify_ms_;
+      };
+
+      // Installs Globals::table_ over checkpoint and Globals::txs_, and
+      // moves Globals::clock_ past the newest recovered epoch. Must run
+      // before any other request is admitted. Returns the recovered requests,
+      // which are allocated from requests, in time order
+      static std::vector<Request*> recover(ColumnFile&& checkpoint, const std::string& log_path,
+                                           const TxTypes& types, RequestPool& requests,
+                                           ExecutionPool* pool = nullptr, Stats* stats = nullptr);
+  };
+
+} // namespace lazy
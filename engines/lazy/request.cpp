@@ -1,5 +1,15 @@
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
 #include "request.h"
+#include "completion.h"
 #include "entry.h"
+#include "interpreter.h"
 #include "linked_table.h"
 #include "lazy_engine.h"
 #include "logs.h"
@@ -9,6 +19,41 @@ using std::memory_order;
 
 namespace lazy {
 
+  Operation Operation::read(Reg dst, int slot) {
+    Operation op;
+    op.ty_ = OperationTy::READ;
+    op.op_.read_ = ReadOp{slot, constants::T_INVALID, dst};
+    return op;
+  }
+
+  Operation Operation::write(int slot, Reg src) {
+    Operation op;
+    op.ty_ = OperationTy::WRITE;
+    op.op_.write_ = WriteOp{slot, constants::T_INVALID, src};
+    return op;
+  }
+
+  Operation Operation::constant(Reg dst, int value) {
+    Operation op;
+    op.ty_ = OperationTy::CONSTANT;
+    op.op_.constant_ = ConstantOp{value, dst};
+    return op;
+  }
+
+  Operation Operation::add(Reg dst, Reg lhs, Reg rhs) {
+    Operation op;
+    op.ty_ = OperationTy::BIN_ADD;
+    op.op_.bin_ = BinOp{dst, lhs, rhs};
+    return op;
+  }
+
+  Operation Operation::mul(Reg dst, Reg lhs, Reg rhs) {
+    Operation op;
+    op.ty_ = OperationTy::BIN_MUL;
+    op.op_.bin_ = BinOp{dst, lhs, rhs};
+    return op;
+  }
+
   bool Operation::is_read() const {
     return ty_ == OperationTy::READ;
   }
@@ -25,20 +70,165 @@ namespace lazy {
     return op_.write_.slot_;
   }
 
-  Tid Request::request_cnt = 0;
+  Operation Operation::as_made() const {
+    // Field by field: stickification may be setting the times meanwhile
+    Operation op{};
+    op.ty_ = ty_;
+    switch (ty_) {
+      case OperationTy::READ:
+        op.op_.read_ = ReadOp{op_.read_.slot_, constants::T_INVALID, op_.read_.dst_};
+        break;
+      case OperationTy::WRITE:
+        op.op_.write_ = WriteOp{op_.write_.slot_, constants::T_INVALID, op_.write_.src_};
+        break;
+      case OperationTy::CONSTANT:
+        op.op_.constant_ = ConstantOp{op_.constant_.value_, op_.constant_.dst_};
+        break;
+      case OperationTy::BIN_ADD:
+      case OperationTy::BIN_MUL:
+        op.op_.bin_ = BinOp{op_.bin_.dst_, op_.bin_.lhs_, op_.bin_.rhs_};
+        break;
+    }
+    return op;
+  }
 
-  void Request::insert_sticky(int slot) {
-    if (Globals::dep_.time_of_last_write_to(slot) == epoch_) {
-      // If we have already written a sticky to this slot for our epoch
-      // don't write another entry in the slot's bucket
-      return;
+  std::atomic<Tid> Request::request_cnt(0);
+
+  Request::Request(bool is_tx, Computation code, bool rw_known_in_advance, const TxShape* shape, Time epoch)
+    : write1_(-1), write2_(-1), write3_(-1),
+      read1_t_(constants::T_INVALID), read2_t_(constants::T_INVALID), read3_t_(constants::T_INVALID),
+      is_tx_(is_tx), fp_(code), rw_known_in_advance_(rw_known_in_advance), shape_(shape),
+      pending_partitions_(0) {
+    set_request_time(epoch);
+  }
+
+  Request* Request::allocate(RequestPool& pool, bool is_tx, Computation code, bool rw_known_in_advance,
+                             const TxShape* shape, Time epoch, int n_ops, int n_reads, int n_writes,
+                             int n_slots, int n_read_ts) {
+    static_assert(sizeof(Request) % alignof(Operation) == 0 && alignof(Operation) == alignof(int),
+                  "The variable-size parts are laid out right after the request");
+    std::size_t bytes = sizeof(Request) + n_ops * sizeof(Operation)
+                      + (n_reads + n_writes + n_slots) * sizeof(int) + n_read_ts * sizeof(Time);
+    char* mem = static_cast<char*>(pool.allocate(bytes));
+    auto* req = new (mem) Request(is_tx, code, rw_known_in_advance, shape, epoch);
+    char* tail = mem + sizeof(Request);
+    auto carve = [&tail](auto& span, int n) {
+      using T = std::remove_reference_t<decltype(span[0])>;
+      span = Span<T>(reinterpret_cast<T*>(tail), n);
+      tail += n * sizeof(T);
+    };
+    carve(req->operations_, n_ops);
+    carve(req->read_set_, n_reads);
+    carve(req->write_set_, n_writes);
+    carve(req->slots_, n_slots);
+    carve(req->read_ts_, n_read_ts);
+    return req;
+  }
+
+  namespace {
+    // Requests may come from outside (e.g. decoded from the command log),
+    // so what they access is checked before anything is stickified or run
+
+    void check_slot(int slot) {
+      int rows = Globals::table_ ? std::min(Globals::table_->rows(), Globals::n_slots) : Globals::n_slots;
+      if (slot < 0 || slot >= rows) {
+        throw std::invalid_argument("Request accesses slot " + std::to_string(slot) + " out of the table");
+      }
+    }
+
+    void check_slots(Span<const int> slots) {
+      for (int slot : slots) {
+        check_slot(slot);
+      }
+    }
+
+    void check_program(Span<const Operation> ops) {
+      if (!Interpreter::valid(ops)) {
+        throw std::invalid_argument("Request program uses a register out of the register file");
+      }
+      for (const auto& op : ops) {
+        if (op.is_read()) {
+          check_slot(op.read_slot());
+        } else if (op.is_write()) {
+          check_slot(op.write_slot());
+        }
+      }
+    }
+  }
+
+  Request* Request::make(RequestPool& pool, bool is_tx, Computation code, Span<const Operation> ops, Time epoch) {
+    check_program(ops);
+    int n_reads = std::count_if(ops.begin(), ops.end(), [](const Operation& op) { return op.is_read(); });
+    int n_writes = std::count_if(ops.begin(), ops.end(), [](const Operation& op) { return op.is_write(); });
+    auto* req = allocate(pool, is_tx, code, false, nullptr, epoch, ops.size(), n_reads, n_writes, 0, 0);
+    std::copy(ops.begin(), ops.end(), req->operations_.begin());
+    int r = 0;
+    int w = 0;
+    for (const auto& op : ops) {
+      if (op.is_read()) {
+        req->read_set_[r++] = op.read_slot();
+      } else if (op.is_write()) {
+        req->write_set_[w++] = op.write_slot();
+      }
+    }
+    return req;
+  }
+
+  Request* Request::make(RequestPool& pool, bool is_tx, Computation code, Span<const Operation> ops,
+                         Span<const int> write_set, Span<const int> read_set, Time epoch) {
+    // Stickification and execution only go by write1_..write3_
+    if (write_set.size() != 3) {
+      throw std::invalid_argument("Request with given sets writes " + std::to_string(write_set.size())
+                                  + " slots rather than 3");
+    }
+    check_program(ops);
+    check_slots(write_set);
+    check_slots(read_set);
+    auto* req = allocate(pool, is_tx, code, true, nullptr, epoch, ops.size(), read_set.size(), write_set.size(), 0, 0);
+    req->write1_ = write_set[0];
+    req->write2_ = write_set[1];
+    req->write3_ = write_set[2];
+    std::copy(ops.begin(), ops.end(), req->operations_.begin());
+    std::copy(read_set.begin(), read_set.end(), req->read_set_.begin());
+    std::copy(write_set.begin(), write_set.end(), req->write_set_.begin());
+    return req;
+  }
+
+  Request* Request::make(RequestPool& pool, bool is_tx, const TxShape* shape, Span<const int> slots, Time epoch) {
+    for (int i = 0; i < shape->n_accesses_; i++) {
+      if (shape->accesses_[i].param_ >= slots.size()) {
+        throw std::invalid_argument("Request has fewer slots than its transaction type");
+      }
+    }
+    check_slots(slots);
+    int n_reads = shape->n_reads_;
+    int n_writes = shape->n_accesses_ - n_reads;
+    auto* req = allocate(pool, is_tx, shape->fp_, true, shape, epoch, 0, n_reads, n_writes, slots.size(), n_reads);
+    std::copy(slots.begin(), slots.end(), req->slots_.begin());
+    int r = 0;
+    int w = 0;
+    for (int i = 0; i < shape->n_accesses_; i++) {
+      const auto& a = shape->accesses_[i];
+      if (a.read_) {
+        req->read_set_[r++] = slots[a.param_];
+      } else {
+        req->write_set_[w++] = slots[a.param_];
+      }
     }
-    Globals::table_->insert_at(0, slot, -epoch_, tid_);
+    return req;
+  }
+
+  void Request::insert_sticky(int slot) {
+    Globals::table_->insert_at(slot, -epoch_, tid_);
   }
 
-  void Request::set_request_time() {
-      tid_ = ++request_cnt;
-      epoch_ = Globals::clock_.advance();
+  void Request::set_request_time(Time epoch) {
+      // One lease per thread, whatever is left of it when the thread exits
+      // is never handed out (see EpochLease)
+      thread_local EpochLease lease(Globals::clock_);
+      tid_ = request_cnt.fetch_add(1, std::memory_order_relaxed) + 1;
+      epoch_ = epoch == constants::T_EMPTY ? lease.next() : epoch;
+      TxStateTable::check_epoch(epoch_);
   }
 
   Time Request::time() const {
@@ -49,94 +239,278 @@ namespace lazy {
     return tid_;
   }
 
-  void Request::stickify() {
+  Span<const Operation> Request::operations() const {
+    return operations_;
+  }
+
+  template<typename Owns, typename Insert>
+  void Request::stickify_slots(Owns&& owns, Insert&& insert, std::vector<Request*>& deps) {
+    // When a tx tries to read a value, it must read it from the time of the
+    // tx which last wrote to it, at the time of stickification.
+    // This ensures that the reads which are performed at substantiation time
+    // are the correct ones. Accesses are visited in program order, so a read
+    // of a slot the tx wrote itself before does not depend on anyone
+    auto read = [this, &deps](int slot, Time& read_t) {
+      Tid writer = Globals::dep_.last_writer_of(slot);
+      read_t = Globals::dep_.time_of_last_write_to(slot);
+      if (writer != LastWrite::NO_TX && writer != tid_) {
+        deps.push_back(Globals::dep_.tx_of(writer));
+      }
+    };
+    auto write = [this, &insert](int slot) {
+      // If we have already written a sticky to this slot for our epoch
+      // don't write another entry in the slot's bucket
+      if (Globals::dep_.time_of_last_write_to(slot) != epoch_) {
+        insert(slot);
+      }
+      Globals::dep_.sticky_written(tid_, slot);
+    };
+
+    if (shape_) {
+      // The accesses were laid out when the transaction type was compiled
+      for (int i = 0; i < shape_->n_accesses_; i++) {
+        const auto& a = shape_->accesses_[i];
+        int slot = slots_[a.param_];
+        if (!owns(slot)) {
+          continue;
+        }
+        if (a.read_) {
+          read(slot, read_ts_[a.read_idx_]);
+        } else {
+          write(slot);
+        }
+      }
+      return;
+    }
+
     if (rw_known_in_advance_) {
-      Globals::dep_.check_dependencies(tid_, read_set_);
-      
+      // Our hardcoded tx always reads a value and writes to it after.
       // TODO: add the read times to the vector<Operation> rather than hardcoded
-      // for (int slot : write_set_) {
-        // insert_sticky(slot);
-        // Globals::dep_.sticky_written(tid_, slot);
-      // }
-
-      read1_t_ = Globals::dep_.time_of_last_write_to(write1_);
-      // cout << "tx " << tid_ << " reads " << write1_ << " from write performed at " << read1_t_ << endl;
-      insert_sticky(write1_);
-      Globals::dep_.sticky_written(tid_, write1_);
-
-      read2_t_ = Globals::dep_.time_of_last_write_to(write2_);
-      // cout << "tx " << tid_ << " reads " << write2_ << " from write performed at " << read2_t_ << endl;
-      insert_sticky(write2_);
-      Globals::dep_.sticky_written(tid_, write2_);
-
-      read3_t_ = Globals::dep_.time_of_last_write_to(write3_);
-      // cout << "tx " << tid_ << " reads " << write3_ << " from write performed at " << read3_t_ << endl;
-      insert_sticky(write3_);
-      Globals::dep_.sticky_written(tid_, write3_);
-
-      stickified_.store(true, std::memory_order_seq_cst);
+      int slots[] = {write1_, write2_, write3_};
+      Time* read_ts[] = {&read1_t_, &read2_t_, &read3_t_};
+      for (int i = 0; i < 3; i++) {
+        if (owns(slots[i])) {
+          read(slots[i], *read_ts[i]);
+          // cout << "tx " << tid_ << " reads " << slots[i] << " from write performed at " << *read_ts[i] << endl;
+          write(slots[i]);
+        }
+      }
       return;
     }
 
     // If rw sets are not known in advance compute 
     // the required slots via interpreting the pseudo-instructions
-    for (const auto& op : operations_) {
-      if (op.is_read()) {
-        read_set_.push_back(op.read_slot());
-      } else if (op.is_write()) {
-        auto slot = op.write_slot();
-        write_set_.push_back(slot);
-        insert_sticky(slot);
+    for (auto& op : operations_) {
+      if (op.is_read() && owns(op.read_slot())) {
+        read(op.read_slot(), op.op_.read_.time_);
+      } else if (op.is_write() && owns(op.write_slot())) {
+        op.op_.write_.time_ = epoch_;
+        write(op.write_slot());
+      }
+    }
+  }
+
+  void Request::stickify() {
+    std::vector<Request*> deps;
+    stickify_slots([](int) { return true; }, [this](int slot) { insert_sticky(slot); }, deps);
+    Globals::dep_.add_dependencies(tid_, deps);
+    state().fetch_or(TxStateTable::STICKIFIED, std::memory_order_seq_cst);
+  }
+
+  void Request::begin_partitioned_stickify(int nparts) {
+    pending_partitions_.store(nparts, std::memory_order_relaxed);
+  }
+
+  void Request::partitions(int nparts, std::vector<int>& out) const {
+    out.clear();
+    auto add = [nparts, &out](int slot) {
+      int part = slot % nparts;
+      if (std::find(out.begin(), out.end(), part) == out.end()) {
+        out.push_back(part);
+      }
+    };
+    if (shape_) {
+      for (int i = 0; i < shape_->n_accesses_; i++) {
+        add(slots_[shape_->accesses_[i].param_]);
+      }
+    } else if (rw_known_in_advance_) {
+      add(write1_);
+      add(write2_);
+      add(write3_);
+    } else {
+      for (const auto& op : operations_) {
+        if (op.is_read()) {
+          add(op.read_slot());
+        } else if (op.is_write()) {
+          add(op.write_slot());
+        }
+      }
+    }
+  }
+
+  void Request::stickify_partition(int part, int nparts) {
+    std::vector<Request*> deps;
+    stickify_slots([part, nparts](int slot) { return slot % nparts == part; },
+                   [this](int slot) { insert_sticky(slot); }, deps);
+    Globals::dep_.add_dependencies(tid_, deps);
+    finish_partition();
+  }
+
+  bool Request::finish_partition() {
+    // The last partition to be done with the request publishes it
+    if (pending_partitions_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      state().fetch_or(TxStateTable::STICKIFIED, std::memory_order_seq_cst);
+      return true;
+    }
+    return false;
+  }
+
+  void Request::stickify_batch(std::vector<Request*>& batch) {
+    for (auto* req : batch) {
+      req->begin_partitioned_stickify(1);
+    }
+    stickify_batch_partition(batch.data(), batch.data() + batch.size(), 0, 1);
+  }
+
+  void Request::stickify_batch_partition(Request* const* begin, Request* const* end, int part, int nparts,
+                                         std::vector<Request*>* ready) {
+    struct Sticky {
+      int slot_;
+      Time t_;
+      Tid tx_;
+    };
+    std::vector<Sticky> stickies;
+    std::vector<std::pair<Tid, Request*>> edges;
+    std::vector<Request*> deps;
+
+    // Last writers are resolved request by request (later requests of the
+    // batch must see the stickies of the earlier ones), but nothing shared
+    // other than the last writers is touched yet
+    auto owns = [part, nparts](int slot) { return slot % nparts == part; };
+    for (auto* it = begin; it != end; it++) {
+      auto* req = *it;
+      deps.clear();
+      req->stickify_slots(owns, [req, &stickies](int slot) {
+        stickies.push_back(Sticky{slot, -req->epoch_, req->tid_});
+      }, deps);
+      for (auto* dep : deps) {
+        edges.emplace_back(req->tid_, dep);
+      }
+    }
+
+    // One pass per slot. The sort is stable, so the stickies of a slot
+    // stay in time order
+    std::stable_sort(stickies.begin(), stickies.end(),
+        [](const Sticky& a, const Sticky& b) { return a.slot_ < b.slot_; });
+    std::vector<Entry::EntryData> run;
+    for (std::size_t i = 0; i < stickies.size();) {
+      std::size_t j = i;
+      run.clear();
+      for (; j < stickies.size() && stickies[j].slot_ == stickies[i].slot_; j++) {
+        run.emplace_back(stickies[j].t_, stickies[j].tx_);
+      }
+      Globals::table_->insert_many(stickies[i].slot_, run.data(), run.size());
+      i = j;
+    }
+
+    Globals::dep_.add_dependencies(edges);
+    for (auto* it = begin; it != end; it++) {
+      if ((*it)->finish_partition() && ready) {
+        ready->push_back(*it);
       }
     }
-    Globals::dep_.check_dependencies(tid_, read_set_);
-    stickified_.store(true, std::memory_order_seq_cst);
   }
 
-  SubstantiateResult Request::substantiate() {
+  SubstantiateResult Request::substantiate(bool wait) {
     // cout << "substantiating this request with txid " << tx_id() << endl;
-		if (!stickified_.load(std::memory_order_seq_cst)) {
+    auto& state = this->state();
+    uint32_t s = state.load(std::memory_order_seq_cst);
+		if (!(s & TxStateTable::STICKIFIED)) {
 			return SubstantiateResult::STALLED;
 		}
-    if (was_performed()) {
+    if (TxStateTable::status_of(s) == ExecutionStatus::DONE) {
       // Someone else already executed this transaction!
       return SubstantiateResult::SUCCESS;
     }
-    
-    // SUG: Use trylock and do something useful if someone is executing this?
-    std::scoped_lock<std::mutex> execute(tx_lock_);
-    auto status = execution_status();
-    if (status == ExecutionStatus::DONE) {
-      // Maybe someone else executed it while we were trying to acquire the lock
-      // in which case we don't need to reexecute the code
+
+    uint32_t expected = TxStateTable::STICKIFIED | static_cast<uint32_t>(ExecutionStatus::UNEXECUTED);
+    uint32_t executing = TxStateTable::STICKIFIED | static_cast<uint32_t>(ExecutionStatus::EXECUTING_NOW);
+    if (!state.compare_exchange_strong(expected, executing, std::memory_order_seq_cst)) {
+      // Someone else executed it or is executing it right now
+      if (!wait) {
+        return was_performed() ? SubstantiateResult::SUCCESS : SubstantiateResult::RUNNING;
+      }
+      wait_for_completion();
       return SubstantiateResult::SUCCESS;
     }
-    if (status == ExecutionStatus::EXECUTING_NOW) {
-      // We are already trying to execute the computation right now
-      // so abort, since we do not want any re-entrancy problems
-      return SubstantiateResult::RUNNING;
-    }
 
+    // We are the only thread which can perform the computation.
     // Substantiate all the transactions that this trans depends on
-    auto deps = Globals::dep_.get_dependencies(tid_);
-    for (auto* tx : deps) {
-      auto _res = tx->substantiate();
-			// The result here should never be stalled or failed,
-			// since the sticky thread itself made the dependency graph
-    }
-    
-    // We are the only thread which can perform the computation. Do it now
-    status_.store(ExecutionStatus::EXECUTING_NOW, std::memory_order_seq_cst);
+    Globals::dep_.get_dependencies(tid_).for_each([](Request* tx) {
+      // The result here is never failed, since the sticky thread itself
+      // made the dependency graph. It may be stalled for a while: a
+      // dependency which also accesses other partitions may still be
+      // stickified by them
+      while (tx->substantiate() == SubstantiateResult::STALLED) {
+        std::this_thread::yield();
+      }
+    });
+
     // cout << "calling fp!" << endl; 
     fp_(this, Globals::table_, write1_, write2_, write3_);
 
     Globals::table_->enforce_wirte_set_substantiation(epoch_, write_set_);
-    status_.store(ExecutionStatus::DONE, std::memory_order_seq_cst);
+    uint32_t done = TxStateTable::STICKIFIED | static_cast<uint32_t>(ExecutionStatus::DONE);
+    uint32_t prev = state.exchange(done, std::memory_order_seq_cst);
+    if (prev & TxStateTable::WAITERS) {
+      completion::wake_all(state);
+    }
 		return SubstantiateResult::SUCCESS;
   }
 
+  void Request::wait_for_completion() {
+    // The executor needs all of our dependencies done before it can run the
+    // computation. Take the ones it did not get to yet off its hands,
+    // newest first since it goes through them oldest first
+    const auto& deps = Globals::dep_.get_dependencies(tid_);
+    std::vector<Request*> pending;
+    deps.for_each([&pending](Request* tx) {
+      if (!tx->was_performed()) {
+        pending.push_back(tx);
+      }
+    });
+    for (auto it = pending.rbegin(); it != pending.rend(); it++) {
+      (*it)->substantiate(false);
+    }
+
+    for (int i = 0; i < completion::SPINS; i++) {
+      if (was_performed()) {
+        return;
+      }
+      completion::cpu_relax();
+    }
+    auto& state = this->state();
+    while (true) {
+      uint32_t s = state.load(std::memory_order_seq_cst);
+      if (TxStateTable::status_of(s) == ExecutionStatus::DONE) {
+        return;
+      }
+      if (!(s & TxStateTable::WAITERS)) {
+        if (!state.compare_exchange_weak(s, s | TxStateTable::WAITERS, std::memory_order_seq_cst)) {
+          continue;
+        }
+        s |= TxStateTable::WAITERS;
+      }
+      completion::park(state, s);
+    }
+  }
+
+  std::atomic<uint32_t>& Request::state() const {
+    return Globals::tx_state_.word(epoch_);
+  }
+
   ExecutionStatus Request::execution_status() const {
-    return status_.load(std::memory_order_seq_cst);
+    return Globals::tx_state_.status(epoch_);
   }
 
   bool Request::was_performed() const {
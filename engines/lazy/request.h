@@ -1,10 +1,13 @@
 #pragma once
 
 #include <vector>
-#include <mutex>
 #include <atomic>
+#include <cstdint>
+#include <type_traits>
 
+#include "arena.h"
 #include "lazy_engine.h"
+#include "span.h"
 #include "types.h"
 
 namespace lazy {
@@ -17,77 +20,162 @@ namespace lazy {
     READ, WRITE, BIN_MUL, BIN_ADD, CONSTANT
   };
 
+  // Operations are run by the Interpreter over a small register file
+  using Reg = int;
+
   struct ReadOp {
     int slot_;
-    Time time_;
+    Time time_; // set at stickification
+    Reg dst_;
   };
 
   struct WriteOp {
     int slot_;
-    Time time_;
+    Time time_; // set at stickification
+    Reg src_;
   };
 
   struct ConstantOp {
     int value_;
+    Reg dst_;
   };
 
-  struct BinAddOp { };
-  struct BinMulOpp { };
+  // dst = lhs op rhs
+  struct BinOp {
+    Reg dst_;
+    Reg lhs_;
+    Reg rhs_;
+  };
 
   struct Operation {
     OperationTy ty_;
     union {
       ReadOp read_;
       WriteOp write_;
-      int bin_add_;
-      int constant_;
+      BinOp bin_;
+      ConstantOp constant_;
     } op_;
 
+    static Operation read(Reg dst, int slot);
+    static Operation write(int slot, Reg src);
+    static Operation constant(Reg dst, int value);
+    static Operation add(Reg dst, Reg lhs, Reg rhs);
+    static Operation mul(Reg dst, Reg lhs, Reg rhs);
+
     bool is_read() const;
     bool is_write() const;
     int read_slot() const;
     int write_slot() const;
+    // The operation without the times set at stickification
+    Operation as_made() const;
   };
 
+  static_assert(sizeof(Operation) == 16, "Operations should stay compact");
 
+  // One slot access of a transaction whose shape is known at compile time
+  // (see TxTemplate), in program order
+  struct StaticAccess {
+    bool read_ = false;
+    // Index of the slot in the request's slot parameters
+    int param_ = 0;
+    // Index of the read among the reads of the transaction
+    int read_idx_ = -1;
+  };
+
+  // Everything about a transaction type which does not depend on the slots
+  // of one particular request
+  struct TxShape {
+    Computation fp_;
+    const StaticAccess* accesses_;
+    int n_accesses_;
+    int n_reads_;
+  };
 
 	enum class SubstantiateResult {
 		SUCCESS, FAIL, STALLED, RUNNING
 	};
 
-  enum class ExecutionStatus {
-    DONE, EXECUTING_NOW, UNEXECUTED
-  };
+  // The requests of one admission epoch. Requests are never destructed or
+  // freed one by one: the pool is released all at once when it is destroyed,
+  // which must only happen once all of its requests are substantiated and
+  // neither Globals::txs_ nor the dependency graph can lead to them anymore
+  using RequestPool = BumpArena;
 
   class Request {
     public:
       using Tid = int;
 
-      // SUG: Heuristic for how many slots would be a read or write so we can
-      // pre-allocate
-      Request(bool is_tx, Computation code, std::vector<Operation>&& ops): is_tx_(is_tx), operations_(std::move(ops)),  fp_(code), rw_known_in_advance_(false) , stickified_(false), status_(ExecutionStatus::UNEXECUTED) {
-        set_request_time();
-      }
-
-      Request(bool is_tx, Computation code, std::vector<Operation>&& ops, std::vector<int>&& write_set, std::vector<int>&& read_set): is_tx_(is_tx), operations_(std::move(ops)), fp_(code), rw_known_in_advance_(true), read_set_(std::move(read_set)) , write_set_(std::move(write_set)), stickified_(false),  status_(ExecutionStatus::UNEXECUTED) {
-      set_request_time();
-    }
+      // Requests are carved out of a RequestPool, together with their
+      // operations, read/write sets and slot parameters, in one allocation.
+      // They are admitted at the next epoch of the calling thread's lease,
+      // unless an epoch is given (recovery puts the requests of the command
+      // log back at the epochs they were logged at). Throw
+      // std::invalid_argument for slots out of the table, registers out of
+      // the Interpreter's register file, or fewer slots than the shape uses,
+      // and std::out_of_range once the epochs of Globals::tx_state_ run out
+
+      // Request running a program. Its read/write sets are derived from ops
+      static Request* make(RequestPool& pool, bool is_tx, Computation code, Span<const Operation> ops,
+                           Time epoch = constants::T_EMPTY);
+      // Request whose read/write sets are given. It reads and then writes
+      // each of the slots of write_set, which must be exactly 3, and code is
+      // run on them
+      static Request* make(RequestPool& pool, bool is_tx, Computation code, Span<const Operation> ops,
+                           Span<const int> write_set, Span<const int> read_set, Time epoch = constants::T_EMPTY);
+      // Request of a transaction type declared with TxTemplate, on the
+      // given slot parameters
+      static Request* make(RequestPool& pool, bool is_tx, const TxShape* shape, Span<const int> slots,
+                           Time epoch = constants::T_EMPTY);
 
       void stickify();
-      SubstantiateResult substantiate();
+      // Stickification of the slots with slot % nparts == part only. Every
+      // one of the nparts partitions given to begin_partitioned_stickify must
+      // stickify the request, the request is stickified once the last of
+      // them is done with it
+      void begin_partitioned_stickify(int nparts);
+      // The distinct partitions (slot % nparts) of the slots the request
+      // accesses, into out
+      void partitions(int nparts, std::vector<int>& out) const;
+      void stickify_partition(int part, int nparts);
+      // Stickifies the requests of the batch (ordered by time) together: last
+      // writers are resolved for the whole batch, the dependency edges are
+      // published together and the stickies are inserted with one pass
+      // per slot
+      static void stickify_batch(std::vector<Request*>& batch);
+      // The same, for the slots of one partition only. Every request must
+      // have been passed to begin_partitioned_stickify. The requests this
+      // partition was the last one to be done with are appended to ready
+      static void stickify_batch_partition(Request* const* begin, Request* const* end, int part, int nparts,
+                                           std::vector<Request*>* ready = nullptr);
+      // Executes the transaction, after its dependencies, unless it was
+      // already. If another thread is executing it, waits for that thread to
+      // be done (helping it with the dependencies meanwhile), or returns
+      // RUNNING right away if !wait
+      SubstantiateResult substantiate(bool wait = true);
       bool was_performed() const;
       ExecutionStatus execution_status() const;
       bool is_being_executed() const;
       Time time() const;
       Tid tx_id() const;
-
-      void set_write_to(int slot1, int slot2, int slot3) {
-        write1_ = slot1; 
-        write2_ = slot2; 
-        write3_ = slot3; 
-        rw_known_in_advance_ = true;
-      }
-
+      // The program of the request, with the read and write times resolved
+      // once it is stickified
+      Span<const Operation> operations() const;
+      // Slot parameter and read times of a TxTemplate request
+      int slot(int param) const { return slots_[param]; }
+      Time read_time(int read_idx) const { return read_ts_[read_idx]; }
+      // What the request was made from (see make), which is what the
+      // command log records of it
+      bool is_tx() const { return is_tx_; }
+      Computation code() const { return fp_; }
+      const TxShape* shape() const { return shape_; }
+      Span<const int> slots() const { return slots_; }
+      Span<const int> write_set() const { return write_set_; }
+      Span<const int> read_set() const { return read_set_; }
+      // Whether the read/write sets were given to make, rather than
+      // derived from the shape or program
+      bool rw_known_in_advance() const { return rw_known_in_advance_ && !shape_; }
+
+    // The slots of a request whose sets are given, -1 for the others
     int write1_;
     int write2_;
     int write3_;
@@ -97,32 +185,50 @@ namespace lazy {
     Time read3_t_;
 
     private:
+      Request(bool is_tx, Computation code, bool rw_known_in_advance, const TxShape* shape, Time epoch);
+      // Room for the variable-size parts, right after the request itself
+      static Request* allocate(RequestPool& pool, bool is_tx, Computation code, bool rw_known_in_advance,
+                               const TxShape* shape, Time epoch, int n_ops, int n_reads, int n_writes,
+                               int n_slots, int n_read_ts);
 
       void insert_sticky(int slot);
-      void set_request_time();
+      void set_request_time(Time epoch);
+      // Resolves the read times and dependencies of the owned slots
+      // and inserts their stickies
+      // Slots written for the first time in this epoch are passed to insert
+      template<typename Owns, typename Insert>
+      void stickify_slots(Owns&& owns, Insert&& insert, std::vector<Request*>& deps);
+      // Whether this was the last partition
+      bool finish_partition();
 
-      static Tid request_cnt;
+      static std::atomic<Tid> request_cnt;
 
       // Transaction, or just normal request?
       bool is_tx_; 
-      std::vector<Operation> operations_; // UNUSED for now since the writes and reads are hardcored
+      Span<Operation> operations_; // Unused by requests whose r/w sets are known in advance
 
       Computation fp_;
       // For testing purposes assume the r/w sets have been determined
       // without the overhead of interpretation
       bool rw_known_in_advance_;
-      std::vector<int> read_set_; 
-      std::vector<int> write_set_; 
+      Span<int> read_set_; 
+      Span<int> write_set_; 
+      // Set for TxTemplate requests only
+      const TxShape* shape_;
+      Span<int> slots_;
+      Span<Time> read_ts_;
       Tid tid_; // This request's id
       Time epoch_; // commit & execution time of the transaction
 
-      // Lock for the actualy computation execution of the transaction. 
-      // Acquired when a transaction is substantiated
-      std::mutex tx_lock_;
-      std::atomic<bool> stickified_;
-      std::atomic<ExecutionStatus> status_;
-  };
+      void wait_for_completion();
+      // The status of the transaction lives in Globals::tx_state_. Going
+      // from UNEXECUTED to EXECUTING_NOW is what makes a thread the (only)
+      // executor of the transaction, the word is also what waiters park on
+      std::atomic<uint32_t>& state() const;
 
-} // namespace lazy
+      std::atomic<int> pending_partitions_;
+  };
 
+  static_assert(std::is_trivially_destructible_v<Request>, "Requests are released with their pool, without being destructed");
 
+} // namespace lazy
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+namespace lazy {
+
+  // Non-owning view of size_ contiguous Ts
+  template<typename T>
+  class Span {
+    public:
+      Span(): data_(nullptr), size_(0) {}
+      Span(T* data, int size): data_(data), size_(size) {}
+      // Only for Span<const T>: the list must outlive the span
+      Span(std::initializer_list<std::remove_const_t<T>> l): data_(l.begin()), size_(l.size()) {}
+      template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+      Span(const Span<U>& other): data_(other.data()), size_(other.size()) {}
+      template<typename Container, typename = decltype(std::declval<Container&>().data())>
+      Span(Container& c): data_(c.data()), size_(c.size()) {}
+
+      T* data() const { return data_; }
+      int size() const { return size_; }
+      bool empty() const { return size_ == 0; }
+      T* begin() const { return data_; }
+      T* end() const { return data_ + size_; }
+      T& operator[](int i) const { return data_[i]; }
+
+    private:
+      T* data_;
+      int size_;
+  };
+
+} // namespace lazy
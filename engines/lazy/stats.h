@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+
+namespace lazy {
+
+  // Event counter for hot paths. Every thread bumps its own cache line,
+  // the total is only computed when the counter is read.
+  class ShardedCounter {
+    public:
+      static constexpr int SHARDS = 64;
+
+      void add(long n = 1) {
+        shards_[shard()].v_.fetch_add(n, std::memory_order_relaxed);
+      }
+
+      long load() const {
+        long total = 0;
+        for (const auto& s : shards_) {
+          total += s.v_.load(std::memory_order_relaxed);
+        }
+        return total;
+      }
+
+    private:
+      struct alignas(64) Shard {
+        std::atomic<long> v_{0};
+      };
+
+      static int shard() {
+        static std::atomic<int> next_shard{0};
+        thread_local int idx = next_shard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+        return idx;
+      }
+
+      Shard shards_[SHARDS];
+  };
+
+} // namespace lazy
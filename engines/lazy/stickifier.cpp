@@ -0,0 +1,92 @@
+#include <algorithm>
+
+#include "stickifier.h"
+
+namespace lazy {
+
+  StickificationLayer::StickificationLayer(int n_threads, ExecutionPool* pool, CommandLog* log)
+    : n_threads_(n_threads), pool_(pool), log_(log), parts_(n_threads), generation_(0), running_(0),
+      stop_(false) {
+    for (int part = 1; part < n_threads_; part++) {
+      threads_.emplace_back(&StickificationLayer::run, this, part);
+    }
+  }
+
+  StickificationLayer::~StickificationLayer() {
+    {
+      std::scoped_lock<std::mutex> lock(lock_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& t : threads_) {
+      t.join();
+    }
+  }
+
+  void StickificationLayer::stickify(const std::vector<Request*>& reqs) {
+    // Every partition only walks the requests which access one of its
+    // slots (requests without any go to partition 0). The commands are
+    // logged on the way, so every one is logged before it is stickified
+    for (auto& mine : parts_) {
+      mine.clear();
+    }
+    std::vector<int> touched;
+    for (std::size_t i = 0; i < reqs.size(); i++) {
+      if (log_ && i % BATCH == 0) {
+        log_->append(reqs.data() + i, reqs.data() + std::min(reqs.size(), i + BATCH));
+      }
+      reqs[i]->partitions(n_threads_, touched);
+      if (touched.empty()) {
+        touched.push_back(0);
+      }
+      reqs[i]->begin_partitioned_stickify(touched.size());
+      for (int part : touched) {
+        parts_[part].push_back(reqs[i]);
+      }
+    }
+
+    {
+      std::scoped_lock<std::mutex> lock(lock_);
+      generation_++;
+      running_ = n_threads_ - 1;
+    }
+    start_.notify_all();
+    stickify_partition(0);
+    std::unique_lock<std::mutex> lock(lock_);
+    done_.wait(lock, [this] { return running_ == 0; });
+  }
+
+  void StickificationLayer::run(int part) {
+    long seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        start_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+        if (stop_) {
+          return;
+        }
+        seen = generation_;
+      }
+      stickify_partition(part);
+      {
+        std::scoped_lock<std::mutex> lock(lock_);
+        running_--;
+      }
+      done_.notify_one();
+    }
+  }
+
+  void StickificationLayer::stickify_partition(int part) {
+    const auto& mine = parts_[part];
+    std::vector<Request*> ready;
+    for (std::size_t i = 0; i < mine.size(); i += BATCH) {
+      std::size_t end = std::min(mine.size(), i + BATCH);
+      ready.clear();
+      Request::stickify_batch_partition(mine.data() + i, mine.data() + end, part, n_threads_, &ready);
+      if (pool_) {
+        pool_->submit(ready);
+      }
+    }
+  }
+
+} // namespace lazy
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "command_log.h"
+#include "execution_worker.h"
+#include "request.h"
+
+namespace lazy {
+
+  // Stickification spread over several threads.
+  //
+  // Slots are partitioned between the threads (slot % n_threads). The
+  // requests are bucketed by the partitions they access up front, and every
+  // thread walks the requests of its bucket in time order, resolving reads
+  // and inserting stickies only in the slots it owns. A slot's last writer,
+  // its bucket and the read times which depend on it are therefore only
+  // ever touched by one thread, in the same order as a single
+  // stickification thread would, which yields the same timestamps, stickies
+  // and dependency edges as the serial Request::stickify() loop. A request
+  // is published as stickified once every partition it accesses is done
+  // with it, which may be before an older request it depends on is
+  // (Request::substantiate waits for such dependencies).
+  //
+  // Requests are handed to Request::stickify_batch_partition BATCH at a time,
+  // so that stickies are inserted with one pass per slot and batch. With
+  // a CommandLog, the commands are appended to it BATCH at a time while the
+  // requests are bucketed, before any of them is stickified.
+  //
+  // The threads of partitions 1..n_threads-1 live as long as the layer, the
+  // calling thread stickifies partition 0, so a layer which stickifies many
+  // small batches does not start threads for each of them.
+  class StickificationLayer {
+    public:
+      static constexpr int BATCH = 256;
+
+      // Stickified requests are fed to pool as they come, if any
+      StickificationLayer(int n_threads, ExecutionPool* pool = nullptr, CommandLog* log = nullptr);
+      StickificationLayer(const StickificationLayer& other) = delete;
+      ~StickificationLayer();
+
+      // Requests must be ordered by time. One call at a time
+      void stickify(const std::vector<Request*>& reqs);
+
+    private:
+      void run(int part);
+      void stickify_partition(int part);
+
+      int n_threads_;
+      ExecutionPool* pool_;
+      CommandLog* log_;
+      // Requests of the current call, per partition
+      std::vector<std::vector<Request*>> parts_;
+
+      std::mutex lock_;
+      std::condition_variable start_;
+      std::condition_variable done_;
+      // Bumped by every call, which the threads wait for
+      long generation_;
+      // Threads still working on the current call
+      int running_;
+      bool stop_;
+      std::vector<std::thread> threads_;
+  };
+
+} // namespace lazy
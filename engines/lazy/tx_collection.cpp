@@ -1,12 +1,45 @@
+#include <algorithm>
+
 #include "tx_collection.h"
+#include "request.h"
 
 namespace lazy {
 
+  TxCollection::TxCollection(std::vector<Request*> txs) {
+    add(txs);
+  }
+
+  TxCollection& TxCollection::operator=(TxCollection&& other) {
+    txs_ = std::move(other.txs_);
+    last_.store(other.last_.exchange(constants::T0));
+    return *this;
+  }
+
+  void TxCollection::add(const std::vector<Request*>& txs) {
+    if (txs.empty()) {
+      return;
+    }
+    for (auto* tx : txs) {
+      txs_.at(tx->time() - constants::T0 - 1) = tx;
+    }
+    // Publishes them to whoever looks up times up to last_time()
+    last_.store(txs.back()->time(), std::memory_order_release);
+  }
+
+  void TxCollection::sequence(std::vector<Request*>& txs) {
+    std::sort(txs.begin(), txs.end(), [](Request* a, Request* b) { return a->time() < b->time(); });
+  }
+
   Request* TxCollection::at(Time t) {
     if (t == constants::T0) {
       return nullptr;
     }
-    return txs_[t - constants::T0 - 1];
+    Request** tx = txs_.find(t - constants::T0 - 1);
+    return tx ? *tx : nullptr;
+  }
+
+  Time TxCollection::last_time() const {
+    return last_.load(std::memory_order_acquire);
   }
 
 }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <vector>
 
+#include "chunked_array.h"
 #include "types.h"
 
 namespace lazy {
@@ -10,10 +12,26 @@ namespace lazy {
   class TxCollection {
     public:
       TxCollection() = default;
-      TxCollection(std::vector<Request*> txs): txs_(std::move(txs)) {}
+      // txs must be sequenced
+      TxCollection(std::vector<Request*> txs);
+      TxCollection(const TxCollection& other) = delete;
+      TxCollection& operator=(TxCollection&& other);
+      // Appends sequenced txs, newer than every transaction in the
+      // collection. Transactions already in it can be looked up meanwhile,
+      // but there must only be one thread adding at a time
+      void add(const std::vector<Request*>& txs);
+      // Sorts requests admitted by several threads (see EpochLease) by time,
+      // which is the order stickification expects them in
+      static void sequence(std::vector<Request*>& txs);
+      // nullptr for the epochs no request was admitted at
       Request* at(Time t);
+      // Time of the newest transaction in the collection
+      Time last_time() const;
     private:
-      std::vector<Request*> txs_;
+      // Indexed by time, leased epochs which were never handed out are holes.
+      // Growing never moves the transactions already in it
+      ChunkedArray<Request*> txs_;
+      std::atomic<Time> last_{constants::T0};
   };
 
 }
@@ -0,0 +1,21 @@
+#include <stdexcept>
+#include <string>
+
+#include "tx_state.h"
+
+namespace lazy {
+
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Words are read straight off the zeroed mapping");
+
+  // Never backed by huge pages: most of the table is never touched
+  TxStateTable::TxStateTable(): region_(MAX_EPOCHS * sizeof(uint32_t), false),
+    words_(static_cast<std::atomic<uint32_t>*>(region_.data())) {}
+
+  void TxStateTable::check_epoch(Time t) {
+    if (t < 0 || t >= MAX_EPOCHS) {
+      throw std::out_of_range("Epoch " + std::to_string(t) + " is past the "
+                              + std::to_string(MAX_EPOCHS) + " epochs of the transaction state table");
+    }
+  }
+
+} // namespace lazy
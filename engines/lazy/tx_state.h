@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+#include "arena.h"
+#include "types.h"
+
+namespace lazy {
+
+  enum class ExecutionStatus : uint32_t {
+    UNEXECUTED, EXECUTING_NOW, DONE
+  };
+
+  // The state of every transaction which the read and substantiation paths
+  // look at, one 32-bit word per transaction, indexed by epoch. The rest of a
+  // transaction (Request) is only touched to stickify or execute it.
+  //
+  // Words are dense, but spread so that consecutive epochs never share a
+  // cache line: within each block of LINE * LINE epochs, the epochs t and
+  // t + 1 are LINE words apart. Transactions which are executed at the same
+  // time are usually close in time, and their status updates would otherwise
+  // bounce the same line between the executing threads.
+  //
+  // Epochs start out UNEXECUTED and not stickified (the mapping is zeroed,
+  // and only backed by memory once it is touched).
+  class TxStateTable {
+    public:
+      // Bits of a word besides its ExecutionStatus
+      static constexpr uint32_t STATUS_MASK = 0x3;
+      static constexpr uint32_t STICKIFIED = 1u << 30;
+      // Set when a thread is parked waiting for the execution
+      static constexpr uint32_t WAITERS = 1u << 31;
+
+      static constexpr int LINE = 64 / sizeof(uint32_t);
+      static constexpr int BLOCK = LINE * LINE;
+      // Words are never recycled: the engine stops admitting requests once
+      // the clock gets there (see check_epoch)
+      static constexpr int64_t MAX_EPOCHS = 1 << 26;
+
+      TxStateTable();
+      TxStateTable(const TxStateTable& other) = delete;
+
+      // Throws std::out_of_range unless the table has a word for epoch t.
+      // Checked once per request when it is admitted, word() only asserts
+      static void check_epoch(Time t);
+
+      std::atomic<uint32_t>& word(Time t) const {
+        assert(t >= 0 && t < MAX_EPOCHS);
+        return words_[index(t)];
+      }
+
+      ExecutionStatus status(Time t) const {
+        return static_cast<ExecutionStatus>(word(t).load(std::memory_order_seq_cst) & STATUS_MASK);
+      }
+
+      bool stickified(Time t) const {
+        return word(t).load(std::memory_order_seq_cst) & STICKIFIED;
+      }
+
+      static ExecutionStatus status_of(uint32_t w) {
+        return static_cast<ExecutionStatus>(w & STATUS_MASK);
+      }
+
+    private:
+      static int64_t index(Time t) {
+        int64_t i = t;
+        return (i & ~int64_t(BLOCK - 1)) | ((i % LINE) * LINE) | ((i / LINE) % LINE);
+      }
+
+      Region region_;
+      std::atomic<uint32_t>* words_;
+  };
+
+} // namespace lazy
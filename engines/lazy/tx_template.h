@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+#include "linked_table.h"
+#include "request.h"
+
+namespace lazy {
+
+  // Building blocks of TxTemplate. The slots a transaction accesses are
+  // parameters of the request (Slot<P> is the P-th one), everything else,
+  // registers included, is fixed at compile time.
+  namespace tx {
+
+    template<int P>
+    struct Slot {
+      static constexpr int param = P;
+    };
+
+    // dst = slot, as of the write the transaction depends on
+    template<Reg Dst, typename S>
+    struct Read {
+      static constexpr bool reads = true;
+      static constexpr bool writes = false;
+      static constexpr int param = S::param;
+      static constexpr Reg max_reg = Dst;
+
+      template<int ReadIdx, typename Ctx>
+      static void exec(Ctx& c) {
+        c.regs_[Dst] = c.tb_->safe_read_int(c.self_->slot(param), 0, c.self_->read_time(ReadIdx), c.call_);
+      }
+    };
+
+    // slot = src, at the time of the transaction
+    template<typename S, Reg Src>
+    struct Write {
+      static constexpr bool reads = false;
+      static constexpr bool writes = true;
+      static constexpr int param = S::param;
+      static constexpr Reg max_reg = Src;
+
+      template<int, typename Ctx>
+      static void exec(Ctx& c) {
+        c.tb_->safe_write_int(c.self_->slot(param), 0, c.regs_[Src], c.t_);
+      }
+    };
+
+    template<Reg Dst, int V>
+    struct Const {
+      static constexpr bool reads = false;
+      static constexpr bool writes = false;
+      static constexpr int param = -1;
+      static constexpr Reg max_reg = Dst;
+
+      template<int, typename Ctx>
+      static void exec(Ctx& c) {
+        c.regs_[Dst] = V;
+      }
+    };
+
+    template<Reg Dst, Reg L, Reg R>
+    struct Add {
+      static constexpr bool reads = false;
+      static constexpr bool writes = false;
+      static constexpr int param = -1;
+      static constexpr Reg max_reg = std::max({Dst, L, R});
+
+      template<int, typename Ctx>
+      static void exec(Ctx& c) {
+        c.regs_[Dst] = c.regs_[L] + c.regs_[R];
+      }
+    };
+
+    template<Reg Dst, Reg L, Reg R>
+    struct Mul {
+      static constexpr bool reads = false;
+      static constexpr bool writes = false;
+      static constexpr int param = -1;
+      static constexpr Reg max_reg = std::max({Dst, L, R});
+
+      template<int, typename Ctx>
+      static void exec(Ctx& c) {
+        c.regs_[Dst] = c.regs_[L] * c.regs_[R];
+      }
+    };
+
+  } // namespace tx
+
+  // Transaction type declared at compile time, on NSlots slot parameters.
+  // From the one declaration come
+  // - run, the Computation, with every operation inlined
+  // - shape, which stickification walks instead of interpreting anything:
+  //   the slot accesses in program order, already laid out
+  //
+  // using Increment = TxTemplate<1, tx::Const<1, 1>, tx::Read<0, tx::Slot<0>>,
+  //                              tx::Add<0, 0, 1>, tx::Write<tx::Slot<0>, 0>>;
+  // auto* req = Increment::make(pool, true, {slot});
+  template<int NSlots, typename... Ops>
+  class TxTemplate {
+    public:
+      static constexpr int READS = (0 + ... + (Ops::reads ? 1 : 0));
+      static constexpr int WRITES = (0 + ... + (Ops::writes ? 1 : 0));
+      static constexpr int ACCESSES = READS + WRITES;
+      static constexpr int REGISTERS = std::max({0, (Ops::max_reg + 1)...});
+
+      static_assert(ACCESSES > 0, "A transaction must access at least one slot");
+      static_assert(((Ops::param < NSlots) && ...), "Slot parameter out of range");
+      static_assert(((Ops::max_reg >= 0) && ...), "Negative register");
+
+      static int run(Request* self, LinkedTable* tb, int, int, int) {
+        Ctx c{self, tb, self->time(), CallingStatus(self->tx_id()), {}};
+        exec_all(c, std::index_sequence_for<Ops...>{});
+        return WRITES;
+      }
+
+      static Request* make(RequestPool& pool, bool is_tx, const std::array<int, NSlots>& slots) {
+        return Request::make(pool, is_tx, &shape, Span<const int>(slots.data(), NSlots));
+      }
+
+      static constexpr std::array<StaticAccess, ACCESSES> accesses = [] {
+        constexpr bool reads[] = {Ops::reads...};
+        constexpr bool writes[] = {Ops::writes...};
+        constexpr int params[] = {Ops::param...};
+        std::array<StaticAccess, ACCESSES> out{};
+        int k = 0;
+        int r = 0;
+        for (std::size_t i = 0; i < sizeof...(Ops); i++) {
+          if (reads[i]) {
+            out[k].read_ = true;
+            out[k].param_ = params[i];
+            out[k].read_idx_ = r++;
+            k++;
+          } else if (writes[i]) {
+            out[k].param_ = params[i];
+            k++;
+          }
+        }
+        return out;
+      }();
+
+      static constexpr TxShape shape{run, accesses.data(), ACCESSES, READS};
+
+    private:
+      struct Ctx {
+        Request* self_;
+        LinkedTable* tb_;
+        Time t_;
+        CallingStatus call_;
+        int regs_[REGISTERS];
+      };
+
+      // Index of the I-th operation among the reads
+      static constexpr int read_index(std::size_t i) {
+        constexpr bool reads[] = {Ops::reads...};
+        int r = 0;
+        for (std::size_t j = 0; j < i; j++) {
+          r += reads[j];
+        }
+        return r;
+      }
+
+      template<std::size_t... I>
+      static void exec_all(Ctx& c, std::index_sequence<I...>) {
+        (std::tuple_element_t<I, std::tuple<Ops...>>::template exec<read_index(I)>(c), ...);
+      }
+  };
+
+} // namespace lazy
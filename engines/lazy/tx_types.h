@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+
+#include "request.h"
+
+namespace lazy {
+
+  // The transaction types a deployment runs, under ids which stay the same
+  // across restarts, so that the command log can name the type of
+  // a request without storing its code. A type is either a Computation (for
+  // requests made from code and a program or read/write sets) or a TxShape
+  // (for TxTemplate requests). There are only ever a handful of them.
+  class TxTypes {
+    public:
+      struct Type {
+        int id_;
+        Computation code_;
+        // nullptr for types which are plain Computations
+        const TxShape* shape_;
+      };
+
+      void add(int id, Computation code) {
+        add(Type{id, code, nullptr});
+      }
+
+      void add(int id, const TxShape* shape) {
+        add(Type{id, shape->fp_, shape});
+      }
+
+      // Throws std::invalid_argument if the type of req was never added
+      int id_of(const Request* req) const {
+        for (const auto& type : types_) {
+          if (req->shape() ? type.shape_ == req->shape() : (type.shape_ == nullptr && type.code_ == req->code())) {
+            return type.id_;
+          }
+        }
+        throw std::invalid_argument("Request of a transaction type which was never added");
+      }
+
+      // nullptr if there is no type with that id
+      const Type* find(int id) const {
+        for (const auto& type : types_) {
+          if (type.id_ == id) {
+            return &type;
+          }
+        }
+        return nullptr;
+      }
+
+    private:
+      void add(Type type) {
+        if (find(type.id_)) {
+          throw std::invalid_argument("Transaction type id added twice");
+        }
+        types_.push_back(type);
+      }
+
+      std::vector<Type> types_;
+  };
+
+} // namespace lazy
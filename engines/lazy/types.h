@@ -11,6 +11,8 @@ namespace lazy {
 
     namespace constants {
         static constexpr int64_t T0 = 1;
+        // Time of an entry which holds no version (zeroed memory)
+        static constexpr int64_t T_EMPTY = 0;
         static constexpr int64_t T_INVALID = std::numeric_limits<int>::max();
         static constexpr int TIMESTAMPS_PER_TUPLE = 5;
     } // namespace constants
@@ -0,0 +1,66 @@
+#include "version_gc.h"
+#include "lazy_engine.h"
+#include "linked_table.h"
+#include "request.h"
+
+namespace lazy {
+
+  VersionGC::VersionGC(LinkedTable* table, std::chrono::milliseconds interval)
+    : table_(table), interval_(interval), frontier_(constants::T0 + 1),
+      passes_(0), retired_chunks_(0), freed_chunks_(0), stop_(false) {}
+
+  VersionGC::~VersionGC() {
+    stop();
+  }
+
+  Time VersionGC::substantiation_frontier() {
+    Time last = Globals::txs_.last_time();
+    while (frontier_ <= last) {
+      // Holes left by epoch leases have nothing to substantiate
+      if (Globals::tx_state_.status(frontier_) != ExecutionStatus::DONE && Globals::txs_.at(frontier_)) {
+        break;
+      }
+      frontier_++;
+    }
+    return frontier_;
+  }
+
+  void VersionGC::collect() {
+    Time low_watermark = Globals::reclaimer_.publish_low_watermark(substantiation_frontier() - 1);
+    retired_chunks_.fetch_add(table_->collect_versions(low_watermark));
+    freed_chunks_.fetch_add(Globals::reclaimer_.reclaim());
+    passes_.fetch_add(1);
+  }
+
+  void VersionGC::start() {
+    stop_ = false;
+    thread_ = std::thread(&VersionGC::run, this);
+  }
+
+  void VersionGC::stop() {
+    {
+      std::scoped_lock<std::mutex> lock(lock_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void VersionGC::run() {
+    std::unique_lock<std::mutex> lock(lock_);
+    while (!stop_) {
+      lock.unlock();
+      collect();
+      lock.lock();
+      wake_.wait_for(lock, interval_, [this] { return stop_; });
+    }
+  }
+
+  VersionGC::Stats VersionGC::stats() const {
+    return Stats{passes_.load(), retired_chunks_.load(), freed_chunks_.load(),
+                 Globals::reclaimer_.low_watermark()};
+  }
+
+} // namespace lazy
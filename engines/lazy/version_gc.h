@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "types.h"
+
+namespace lazy {
+
+  class LinkedTable;
+
+  // Background collector of the versions no reader can ask for anymore.
+  //
+  // The low-watermark is the minimum of
+  // - the time right before the oldest transaction which is not substantiated
+  //   yet: such a transaction reads, in every slot, the newest version older
+  //   than itself, which is never older than the newest version at or before
+  //   the low-watermark
+  // - the oldest time pinned by a reader (see Reclaimer::Pin)
+  // In every slot, everything older than the newest substantiated version at
+  // or before the low-watermark is dropped. The dropped chunks are reclaimed
+  // through Globals::reclaimer_, once no safe_read_int which may still be
+  // traversing them is running.
+  class VersionGC {
+    public:
+      struct Stats {
+        long passes_;
+        long retired_chunks_;
+        long freed_chunks_;
+        Time low_watermark_;
+      };
+
+      VersionGC(LinkedTable* table, std::chrono::milliseconds interval);
+      VersionGC(const VersionGC& other) = delete;
+      ~VersionGC();
+
+      // Runs one collection pass on the calling thread
+      void collect();
+      void start();
+      void stop();
+      Stats stats() const;
+
+    private:
+      Time substantiation_frontier();
+      void run();
+
+      LinkedTable* table_;
+      std::chrono::milliseconds interval_;
+      // Oldest transaction not known to be substantiated
+      Time frontier_;
+
+      std::atomic<long> passes_;
+      std::atomic<long> retired_chunks_;
+      std::atomic<long> freed_chunks_;
+
+      std::mutex lock_;
+      std::condition_variable wake_;
+      bool stop_;
+      std::thread thread_;
+  };
+
+} // namespace lazy
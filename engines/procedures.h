@@ -0,0 +1,17 @@
+#pragma once
+
+namespace engines {
+
+  // The stored procedures of the TxTypes, for the engines which run them on
+  // a transaction with read(slot) and write(slot, val) (the lazy engine
+  // declares them as TxTemplates or programs instead)
+
+  // INCREMENT, the same computation as lazy's mock_computation
+  template<typename Txn>
+  void increment(Txn& tx, const int* slots, int n, int* /* out */) {
+    for (int i = 0; i < n; i++) {
+      tx.write(slots[i], tx.read(slots[i]) + 1);
+    }
+  }
+
+} // namespace engines
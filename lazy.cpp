@@ -9,30 +9,60 @@
 #include <algorithm>
 #include <random>
 #include <chrono>
+#include <cstdio>
 
 #include "lazy.h"
+#include "engines/lazy/checkpointer.h"
+#include "engines/lazy/column_file.h"
 #include "engines/lazy/execution_worker.h"
+#include "engines/lazy/interpreter.h"
 #include "engines/lazy/linked_table.h"
+#include "engines/lazy/recovery.h"
+#include "engines/lazy/stickifier.h"
+#include "engines/lazy/tx_types.h"
+#include "engines/lazy/tx_template.h"
+#include "engines/lazy/version_gc.h"
 
 using std::cout;
 using std::endl;
 
 namespace lazy {
 
-void sticky_fn(std::vector<Request*>& reqs) {
-  for (auto* req : reqs) {
-    req->stickify();
-  }
+void sticky_fn(std::vector<Request*>& reqs, ExecutionPool* pool, CommandLog* log) {
+  StickificationLayer(Globals::sticky_cores, pool, log).stickify(reqs);
   cout << "stickification performed" << endl;
 }
 
-void client_calls(const std::vector<std::pair<int, int>>& writes) {
-  std::vector<std::pair<int, int>> accesses = writes;
+void client_calls(const std::vector<SlotRead>& writes, std::atomic<int>& pinned) {
+  // Clients read this many slots per request
+  constexpr int CLIENT_BATCH = 256;
+  std::vector<SlotRead> accesses = writes;
   unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-
-  shuffle (accesses.begin(), accesses.end(), std::default_random_engine(seed));
-  for (const auto& access : accesses) {
-    Globals::table_->safe_read_int(access.first, 0, access.second, CallingStatus::client());
+  std::default_random_engine engine(seed);
+
+  // Batches read versions close in time (in random order within a batch),
+  // so that the pin of a client only ever holds back the version gc from
+  // the batch it is reading
+  std::sort(accesses.begin(), accesses.end(), [](const SlotRead& a, const SlotRead& b) { return a.t_ < b.t_; });
+  Time first = accesses.empty() ? constants::T0 : accesses[0].t_;
+  for (std::size_t i = 0; i < accesses.size(); i += CLIENT_BATCH) {
+    shuffle(accesses.begin() + i, accesses.begin() + std::min(accesses.size(), i + CLIENT_BATCH), engine);
+  }
+  auto oldest = [&accesses](std::size_t i, int n) {
+    Time t = accesses[i].t_;
+    for (int j = 1; j < n; j++) {
+      t = std::min(t, accesses[i + j].t_);
+    }
+    return t;
+  };
+
+  Reclaimer::Pin pin(Globals::reclaimer_, first);
+  pinned.fetch_add(1);
+  int vals[CLIENT_BATCH];
+  for (std::size_t i = 0; i < accesses.size(); i += CLIENT_BATCH) {
+    int n = std::min<std::size_t>(CLIENT_BATCH, accesses.size() - i);
+    pin.advance(oldest(i, n));
+    Globals::table_->read_many(0, Span<const SlotRead>(accesses.data() + i, n), vals);
   }
 }
 
@@ -62,27 +92,71 @@ Writes::Writes(std::mt19937& gen) {
   ws_.push_back(dis(gen));
 }
 
-Request* mock_tx(std::mt19937& gen, std::vector<std::pair<int, int>>& writes) {
+// The same computation as mock_computation, as a TxTemplate
+using MockTx = TxTemplate<3,
+  tx::Const<1, 1>,
+  tx::Read<0, tx::Slot<0>>, tx::Add<0, 0, 1>, tx::Write<tx::Slot<0>, 0>,
+  tx::Read<0, tx::Slot<1>>, tx::Add<0, 0, 1>, tx::Write<tx::Slot<1>, 0>,
+  tx::Read<0, tx::Slot<2>>, tx::Add<0, 0, 1>, tx::Write<tx::Slot<2>, 0>>;
+
+// Ids of the mock transaction types in the command log
+enum MockTxType { MOCK_COMPILED = 1, MOCK_PROGRAM = 2, MOCK_TEMPLATE = 3 };
+
+TxTypes mock_tx_types() {
+  TxTypes types;
+  types.add(MOCK_COMPILED, mock_computation);
+  types.add(MOCK_PROGRAM, Interpreter::run);
+  types.add(MOCK_TEMPLATE, &MockTx::shape);
+  return types;
+}
+
+Request* mock_tx(RequestPool& pool, std::mt19937& gen, std::vector<SlotRead>& writes) {
   Writes w(gen);
   int w1 = w.ws_[0];
   int w2 = w.ws_[1];
   int w3 = w.ws_[2];
 
-  std::vector<int> ws{w.ws_.begin(), w.ws_.end()};
-  std::vector<int> rs = ws;
-  auto* req = new Request(true, mock_computation, {}, std::move(ws), std::move(rs));
+  Request* req;
+  if (Globals::mock_txs == Globals::MockTxs::TEMPLATE) {
+    req = MockTx::make(pool, true, {w1, w2, w3});
+  } else if (Globals::mock_txs == Globals::MockTxs::INTERPRETED) {
+    // The same computation as mock_computation, as a program
+    std::vector<Operation> ops{Operation::constant(1, 1)};
+    for (int slot : w.ws_) {
+      ops.push_back(Operation::read(0, slot));
+      ops.push_back(Operation::add(0, 0, 1));
+      ops.push_back(Operation::write(slot, 0));
+    }
+    req = Request::make(pool, true, Interpreter::run, ops);
+  } else {
+    req = Request::make(pool, true, mock_computation, {}, w.ws_, w.ws_);
+  }
 
-  writes.emplace_back(w1, req->time());
-  writes.emplace_back(w2, req->time());
-  writes.emplace_back(w3, req->time());
+  writes.push_back(SlotRead{w1, req->time()});
+  writes.push_back(SlotRead{w2, req->time()});
+  writes.push_back(SlotRead{w3, req->time()});
 
   // cout << w1 << " " << w2 << " " << w3 << endl;
-  req->set_write_to(w1, w2, w3);
   return req;
 }
 
 
-void run() {
+// Only the first run pays for writing the table, later ones just map it.
+// Unless recovering, a checkpoint left by a previous run is replaced by the
+// base table
+ColumnFile open_table_file(bool recover) {
+  if (ColumnFile::exists(Globals::table_file)) {
+    ColumnFile file(Globals::table_file);
+    if (file.rows() == Globals::n_slots && (recover || file.epoch() == constants::T0)) {
+      return file;
+    }
+  }
+  std::vector<int> data(Globals::n_slots, 1);
+  ColumnFile::write(Globals::table_file, data.data(), Globals::n_slots);
+  return ColumnFile(Globals::table_file);
+}
+
+void run(bool recover) {
   if (!std::atomic<Entry::EntryData>().is_lock_free()) {
     cout << "Entry data is not lock free. Aborting!" << endl;
     exit(1);
@@ -96,43 +170,114 @@ void run() {
   // this is around 4GB of memory occupied by the table
 
   int cores = Globals::subst_cores;
+  // All the requests of the run are released together, at the end. A run
+  // admits a fixed number of them (Globals::tx_count, plus the recovered
+  // ones), so this bounds what it holds. Releasing pools per epoch behind
+  // the gc low-watermark would also need Globals::txs_ and the dependency
+  // graph to drop their requests there, which neither does yet
+  RequestPool requests(Globals::huge_pages);
+  TxTypes types = mock_tx_types();
+  // Recovered first: the requests of this run come after them
+  std::vector<Request*> recovered;
+  if (recover) {
+    Recovery::Stats stats;
+    recovered = Recovery::recover(open_table_file(true), Globals::log_file, types, requests, nullptr, &stats);
+    cout << "recovery: checkpoint at epoch " << stats.checkpoint_ << ", " << stats.replayed_
+         << " commands up to epoch " << stats.last_epoch_ << " read in " << stats.read_ms_ << " ms and stickified in "
+         << stats.stickify_ms_ << " ms, none executed (" << stats.torn_segments_ << " torn log segments)" << endl;
+  } else {
+    // Every run starts from the base table, with a fresh log
+    for (const auto& segment : CommandLog::segments(Globals::log_file)) {
+      std::remove(segment.path_.c_str());
+    }
+    Globals::table_ = new LinkedTable(open_table_file(false));
+  }
+
   std::vector<std::vector<Request*>> txs(cores);
   std::vector<Request*> to_stickify;
-  std::vector<std::pair<int, int>> writes;
+  std::vector<SlotRead> writes;
   to_stickify.reserve(Globals::tx_count);
 
   for (int i = 0; i < Globals::subst_cores; i++) {
     txs[i].reserve(Globals::tx_count / cores);
     for (int j = 0; j < Globals::tx_count / cores; j++) {
-      auto* req = mock_tx(gen, writes);
+      auto* req = mock_tx(requests, gen, writes);
       txs[i].emplace_back(req);
       to_stickify.emplace_back(req);
     }
   }
+  TxCollection::sequence(to_stickify);
   Globals::dep_.add_txs(to_stickify);
-  
-  std::vector<int> data(Globals::n_slots, 1);
-  auto* cols = new std::vector<LinkedIntColumn>();
-  cols->emplace_back(std::move(data));
-  Globals::table_ = new LinkedTable(cols);
-  Globals::txs_ = TxCollection(to_stickify);
+  std::vector<Request*> all = recovered;
+  all.insert(all.end(), to_stickify.begin(), to_stickify.end());
+  Globals::txs_ = TxCollection(all);
 
   std::vector<std::thread> ts;
-  sticky_fn(to_stickify);
-  
-  for (int i = 0; i < cores; i++) {
-    ts.emplace_back(client_calls, std::ref(writes));
+  // Stickified transactions are substantiated proactively in the background,
+  // clients only substantiate the ones the pool did not get to yet
+  ExecutionPool pool(cores);
+  CommandLog log(Globals::log_file, types);
+  sticky_fn(to_stickify, &pool, &log);
+  // Every transaction is committed once its command is on disk
+  log.wait_durable(to_stickify.back()->time());
+
+  VersionGC gc(Globals::table_, std::chrono::milliseconds(10));
+  // Checkpoints replace the table file, which stays mapped as it was
+  Checkpointer checkpointer(Globals::table_, &log, Globals::table_file, std::chrono::milliseconds(50));
+  std::atomic<int> pinned(0);
+  {
+    // Clients read versions of the past: keep the version gc off all of
+    // them until every client pinned the oldest one it reads
+    Reclaimer::Pin pin(Globals::reclaimer_, constants::T0);
+    gc.start();
+    checkpointer.start();
+
+    for (int i = 0; i < cores; i++) {
+      ts.emplace_back(client_calls, std::ref(writes), std::ref(pinned));
+    }
+    while (pinned.load() < cores) {
+      std::this_thread::yield();
+    }
   }
   for (auto& t : ts) {
     t.join();
   }
 
-  cout << "checksum at the end: " << Globals::table_->checksum() << endl;
+  pool.wait_idle();
+  auto pool_stats = pool.stats();
+  pool.shutdown();
+  cout << "substantiation pool: " << pool_stats.substantiated_ << " requests, "
+       << pool_stats.throughput() << " req/s, " << pool_stats.steals_ << "/" << pool_stats.steal_attempts_
+       << " steals, " << pool_stats.parks_ << " parks, " << pool_stats.stalled_ << " stalled" << endl;
+
+  checkpointer.stop();
+  checkpointer.checkpoint();
+  auto checkpoint_stats = checkpointer.stats();
+  cout << "checkpoints: " << checkpoint_stats.checkpoints_ << " written (" << checkpoint_stats.bytes_
+       << " bytes), the newest at epoch " << checkpoint_stats.epoch_ << ", "
+       << checkpoint_stats.truncated_segments_ << " log segments truncated" << endl;
+
+  auto log_stats = log.stats();
+  cout << "command log: " << log_stats.records_ << " commands, " << log_stats.bytes_ << " bytes in "
+       << log_stats.groups_ << " group commits (" << (log_stats.groups_ ? log_stats.records_ / log_stats.groups_ : 0)
+       << " commands per fdatasync), durable up to " << log_stats.durable_ << endl;
+
+  gc.stop();
+  gc.collect();
+  auto gc_stats = gc.stats();
+  cout << "version gc: " << gc_stats.passes_ << " passes, low-watermark " << gc_stats.low_watermark_
+       << ", " << gc_stats.retired_chunks_ << " chunks retired, " << gc_stats.freed_chunks_ << " freed" << endl;
+
+  cout << "checksum at the end: " << Globals::table_->checksum(Globals::subst_cores) << endl;
+
+  auto read_stats = Globals::table_->read_stats();
+  long reads = read_stats.fast_hits_ + read_stats.chain_walks_;
+  cout << "last write fast path: " << read_stats.fast_hits_ << "/" << reads << " reads ("
+       << (reads ? 100.0 * read_stats.fast_hits_ / reads : 0) << "%)" << endl;
 
   lazy::Globals::shutdown();
-  for (auto* req : to_stickify) {
-    delete req;
-  }
+  // Every request is substantiated, and none is reachable anymore
+  Globals::txs_ = TxCollection();
 
   /* TODO:
     On main process requests, give them to the thread which does substantiation layer,
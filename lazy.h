@@ -3,7 +3,9 @@
 #include <random>
 #include <vector>
 
+#include "engines/lazy/command_log.h"
 #include "engines/lazy/entry.h"
+#include "engines/lazy/execution_worker.h"
 #include "engines/lazy/lazy_engine.h"
 #include "engines/lazy/request.h"
 
@@ -14,8 +16,10 @@ struct Writes {
   std::vector<int> ws_;
 };
 
-void run();
+// Starts from the base table, or recovers what the previous run left if
+// recover (see Recovery)
+void run(bool recover = false);
 void subst_fn();
-void sticky_fn();
+void sticky_fn(std::vector<Request*>& reqs, ExecutionPool* pool, CommandLog* log);
 
 } // namespace lazy
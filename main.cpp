@@ -1,8 +1,35 @@
 #include <iostream>
+#include <string>
+#include "eager.h"
 #include "lazy.h"
 
 
+// lazy [--recover] | lazy --engine=eager [--local]
 int main(int argc, char** argv) {
-  lazy::run();
+  std::string engine = "lazy";
+  bool recover = false;
+  bool local = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--recover") {
+      recover = true;
+    } else if (arg == "--local") {
+      local = true;
+    } else if (arg.rfind("--engine=", 0) == 0) {
+      engine = arg.substr(9);
+    } else {
+      std::cerr << "unknown argument " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  if (engine == "lazy") {
+    lazy::run(recover);
+  } else if (engine == "eager") {
+    eager::run(local);
+  } else {
+    std::cerr << "unknown engine " << engine << std::endl;
+    return 1;
+  }
   return 0;
 }
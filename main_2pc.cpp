@@ -0,0 +1,7 @@
+#include "2pc.h"
+
+
+int main(int argc, char** argv) {
+  twopc::run();
+  return 0;
+}